@@ -5,10 +5,36 @@ include $(CLEAR_VARS)
 LOCAL_MODULE    := libflowers-jni
 LOCAL_CFLAGS    += -Wall -Werror -Wextra
 
-LOCAL_SRC_FILES := flowers_main.c \
+# Build with "ndk-build GL_CAPTURE=1" to record GL command stream
+# for replaying with tools/gl_replay.c.
+ifeq ($(GL_CAPTURE),1)
+LOCAL_CFLAGS    += -DGL_CAPTURE
+endif
+
+# Build with "ndk-build LOG_LEVEL=2" to include verbose logging, levels
+# are listed in log.h. Records below given level are compiled out.
+ifdef LOG_LEVEL
+LOCAL_CFLAGS    += -DLOG_LEVEL=$(LOG_LEVEL)
+endif
+
+# Build with "ndk-build EAGER_START=0" to create EGL context only once
+# wallpaper becomes visible. Time to first frame is logged along with
+# entry point latencies for comparing the two.
+ifeq ($(EAGER_START),0)
+LOCAL_CFLAGS    += -DFLOWERS_EAGER_START=GL_THREAD_FALSE
+endif
+
+LOCAL_SRC_FILES := flowers_clock.c \
+                   flowers_color.c \
+                   flowers_main.c \
                    flowers_renderer.c \
+                   flowers_snapshot.c \
+                   gl_capture.c \
+                   gl_sprite.c \
                    gl_thread.c \
-                   gl_utils.c
+                   gl_utils.c \
+                   gl_vertex.c \
+                   log.c
 
 LOCAL_LDLIBS    := -landroid \
                    -llog \
@@ -0,0 +1,59 @@
+/*
+ Copyright 2012 Harri Smtt
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+ */
+
+#include <time.h>
+#include "flowers_clock.h"
+
+flowers_nanos_t flowers_ClockNanos() {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+void flowers_ClockInit(flowers_clock_t *clock, flowers_nanos_t tickNanos,
+		int32_t maxTicks) {
+	clock->tickNanos = tickNanos;
+	clock->maxTicks = maxTicks;
+	clock->tickCount = 0;
+	flowers_ClockReset(clock);
+}
+
+void flowers_ClockReset(flowers_clock_t *clock) {
+	clock->lastTime = flowers_ClockNanos();
+	clock->accumulator = 0;
+	clock->alpha = 0.f;
+}
+
+int32_t flowers_ClockAdvance(flowers_clock_t *clock) {
+	flowers_nanos_t time = flowers_ClockNanos();
+	clock->accumulator += time - clock->lastTime;
+	clock->lastTime = time;
+
+	int32_t ticks = clock->accumulator / clock->tickNanos;
+	// Drop time we're not going to catch up with.
+	if (ticks > clock->maxTicks) {
+		ticks = clock->maxTicks;
+		clock->accumulator = ticks * clock->tickNanos;
+	}
+	clock->accumulator -= ticks * clock->tickNanos;
+	clock->tickCount += ticks;
+	clock->alpha = (float) clock->accumulator / clock->tickNanos;
+	return ticks;
+}
+
+float flowers_ClockTickSeconds(const flowers_clock_t *clock) {
+	return clock->tickNanos / 1000000000.f;
+}
@@ -0,0 +1,68 @@
+/*
+ Copyright 2012 Harri Smtt
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+ */
+
+#ifndef FLOWERS_CLOCK_H__
+#define FLOWERS_CLOCK_H__
+
+#include <stdint.h>
+
+typedef int64_t flowers_nanos_t;
+
+/*
+ Fixed timestep clock. Real time elapsed between frames is consumed in
+ fixed size ticks, leftover is exposed as interpolation factor between
+ previous and current simulation state.
+ */
+typedef struct {
+	flowers_nanos_t tickNanos;
+	int32_t maxTicks;
+	flowers_nanos_t lastTime;
+	flowers_nanos_t accumulator;
+	uint64_t tickCount;
+	float alpha;
+} flowers_clock_t;
+
+/*
+ Returns CLOCK_MONOTONIC time in nanoseconds.
+ */
+flowers_nanos_t flowers_ClockNanos();
+
+/*
+ Initializes clock with given tick length. At most maxTicks are
+ returned from one flowers_ClockAdvance call, time beyond that is
+ dropped so that long pauses don't cause catch-up bursts.
+ */
+void flowers_ClockInit(flowers_clock_t *clock, flowers_nanos_t tickNanos,
+		int32_t maxTicks);
+
+/*
+ Restarts measuring elapsed time from now, without touching tick count.
+ Should be called when rendering resumes after a pause.
+ */
+void flowers_ClockReset(flowers_clock_t *clock);
+
+/*
+ Returns number of ticks simulation should be stepped for current frame
+ and updates interpolation factor.
+ */
+int32_t flowers_ClockAdvance(flowers_clock_t *clock);
+
+/*
+ Returns tick length in seconds.
+ */
+float flowers_ClockTickSeconds(const flowers_clock_t *clock);
+
+#endif
@@ -0,0 +1,140 @@
+/*
+ Copyright 2012 Harri Smtt
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+ */
+
+
+#include <math.h>
+#if defined(__SSE__)
+#include <xmmintrin.h>
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+#include "flowers_color.h"
+
+// Four lanes processed with single instructions where target supports it,
+// GCC falls back to scalar code elsewhere.
+typedef float flowers_vec4_t __attribute__ ((vector_size (16)));
+typedef int32_t flowers_vec4i_t __attribute__ ((vector_size (16)));
+
+// Predefined schemes, starting from FLOWERS_COLOR_SCHEME_SUMMER.
+const flowers_color_scheme_t flowers_colorSchemes[] = {
+		{ 0x80AA8060, 0x80AA80A0, 0xFF808080, 0xFFAA8060 },
+		{ 0x80D08030, 0x80A04020, 0xFF706050, 0xFF904020 },
+		{ 0x80C0D0E0, 0x80A0B0D0, 0xFF6080A0, 0xFFD0D8E0 },
+		{ 0x80F0A0C0, 0x80E0E080, 0xFF80A0C0, 0xFF70A060 } };
+
+// Returns vector with all lanes set to given value.
+static inline flowers_vec4_t flowers_Vec4(float value) {
+	flowers_vec4_t v = { value, value, value, value };
+	return v;
+}
+
+// Square root of each lane.
+static inline flowers_vec4_t flowers_Vec4Sqrt(flowers_vec4_t v) {
+#if defined(__SSE__)
+	return (flowers_vec4_t) _mm_sqrt_ps((__m128) v);
+#elif defined(__aarch64__)
+	return (flowers_vec4_t) vsqrtq_f32((float32x4_t) v);
+#else
+	flowers_vec4_t r = { sqrtf(v[0]), sqrtf(v[1]), sqrtf(v[2]), sqrtf(v[3]) };
+	return r;
+#endif
+}
+
+// Picks lanes from a where mask is set and from b elsewhere.
+static inline flowers_vec4_t flowers_Vec4Select(flowers_vec4i_t mask,
+		flowers_vec4_t a, flowers_vec4_t b) {
+	return (flowers_vec4_t) (((flowers_vec4i_t) a & mask)
+			| ((flowers_vec4i_t) b & ~mask));
+}
+
+// Raises lanes into power given as binary fraction, bit k standing
+// for 2^-k. Uses repeated square roots only, so it vectorizes fully.
+static inline flowers_vec4_t flowers_Vec4Pow(flowers_vec4_t v, uint32_t bits) {
+	flowers_vec4_t r = flowers_Vec4(1.f);
+	int k;
+	for (k = 1; bits >> k; ++k) {
+		v = flowers_Vec4Sqrt(v);
+		if (bits & (1u << k)) {
+			r *= v;
+		}
+	}
+	return r;
+}
+
+// Binary fractions of 0.4 and 1 / 2.4, accurate to 2^-11.
+#define FLOWERS_POW_0_4 ((1u << 2) | (1u << 3) | (1u << 6) | (1u << 7) \
+		| (1u << 10) | (1u << 11))
+#define FLOWERS_POW_1_2_4 ((1u << 2) | (1u << 3) | (1u << 5) | (1u << 7) \
+		| (1u << 9) | (1u << 11))
+
+// Unpacks ARGB into RGBA vector in range [0, 1].
+static inline flowers_vec4_t flowers_ColorUnpack(uint32_t argb) {
+	flowers_vec4_t v = { (argb >> 16) & 0xFF, (argb >> 8) & 0xFF, argb & 0xFF,
+			argb >> 24 };
+	return v * flowers_Vec4(1.f / 255.f);
+}
+
+// Converts sRGB encoded color into linear space. Alpha is linear
+// already and is kept as it is.
+static inline flowers_vec4_t flowers_ColorToLinear(flowers_vec4_t c) {
+	const flowers_vec4_t rgb = { 1.f, 1.f, 1.f, 0.f };
+	const flowers_vec4_t alpha = { 0.f, 0.f, 0.f, 1.f };
+	flowers_vec4_t x = (c + flowers_Vec4(.055f)) * flowers_Vec4(1.f / 1.055f);
+	flowers_vec4_t curve = x * x * flowers_Vec4Pow(x, FLOWERS_POW_0_4);
+	flowers_vec4_t lin = flowers_Vec4Select(c > flowers_Vec4(.04045f), curve,
+			c * flowers_Vec4(1.f / 12.92f));
+	return lin * rgb + c * alpha;
+}
+
+// Converts linear color into sRGB encoded one. Alpha is kept as it is.
+static inline flowers_vec4_t flowers_ColorToSRGB(flowers_vec4_t c) {
+	const flowers_vec4_t rgb = { 1.f, 1.f, 1.f, 0.f };
+	const flowers_vec4_t alpha = { 0.f, 0.f, 0.f, 1.f };
+	flowers_vec4_t curve = flowers_Vec4Pow(c, FLOWERS_POW_1_2_4)
+			* flowers_Vec4(1.055f) - flowers_Vec4(.055f);
+	flowers_vec4_t srgb = flowers_Vec4Select(c > flowers_Vec4(.0031308f),
+			curve, c * flowers_Vec4(12.92f));
+	return srgb * rgb + c * alpha;
+}
+
+// Stores color into bytes, clamping it into range [0, 1].
+static inline void flowers_ColorPack(flowers_vec4_t c, uint8_t *rgba) {
+	c = c * flowers_Vec4(255.f) + flowers_Vec4(.5f);
+	int idx;
+	for (idx = 0; idx < 4; ++idx) {
+		rgba[idx] = c[idx] < 0.f ? 0 : c[idx] > 255.f ? 255 : (uint8_t) c[idx];
+	}
+}
+
+void flowers_ColorSchemePreset(int scheme, flowers_color_scheme_t *colors) {
+	if (scheme > FLOWERS_COLOR_SCHEME_CUSTOM
+			&& scheme < FLOWERS_COLOR_SCHEME_COUNT) {
+		*colors = flowers_colorSchemes[scheme - FLOWERS_COLOR_SCHEME_SUMMER];
+	}
+}
+
+void flowers_ColorBakeGradient(uint32_t from, uint32_t to, uint8_t *rgba,
+		int count) {
+	flowers_vec4_t start = flowers_ColorToLinear(flowers_ColorUnpack(from));
+	flowers_vec4_t delta = flowers_ColorToLinear(flowers_ColorUnpack(to))
+			- start;
+	int idx;
+	for (idx = 0; idx < count; ++idx) {
+		float t = count > 1 ? (float) idx / (count - 1) : 0.f;
+		flowers_vec4_t c = start + delta * flowers_Vec4(t);
+		flowers_ColorPack(flowers_ColorToSRGB(c), rgba + idx * 4);
+	}
+}
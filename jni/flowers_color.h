@@ -0,0 +1,59 @@
+/*
+ Copyright 2012 Harri Smtt
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+ */
+
+
+#ifndef FLOWERS_COLOR_H__
+#define FLOWERS_COLOR_H__
+
+#include <stdint.h>
+
+/*
+ Color scheme identifiers, these match with colors_scheme_values in
+ preferences. Custom scheme uses colors chosen by user.
+ */
+#define FLOWERS_COLOR_SCHEME_CUSTOM  0
+#define FLOWERS_COLOR_SCHEME_SUMMER  1
+#define FLOWERS_COLOR_SCHEME_AUTUMN  2
+#define FLOWERS_COLOR_SCHEME_WINTER  3
+#define FLOWERS_COLOR_SCHEME_SPRING  4
+#define FLOWERS_COLOR_SCHEME_COUNT   5
+
+/*
+ Scheme colors as packed ARGB values, in the form preferences store them.
+ */
+typedef struct {
+	uint32_t flower1;
+	uint32_t flower2;
+	uint32_t bgTop;
+	uint32_t bgBottom;
+} flowers_color_scheme_t;
+
+/*
+ Replaces colors with predefined ones for given scheme. Custom or
+ unknown scheme leaves colors untouched.
+ */
+void flowers_ColorSchemePreset(int scheme, flowers_color_scheme_t *colors);
+
+/*
+ Bakes gradient between two packed ARGB colors into count RGBA texels.
+ Colors are converted into linear space and interpolated there, texels
+ are stored sRGB encoded. Conversions are done for all four channels
+ at once using vector extensions.
+ */
+void flowers_ColorBakeGradient(uint32_t from, uint32_t to, uint8_t *rgba,
+		int count);
+
+#endif
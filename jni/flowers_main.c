@@ -14,20 +14,74 @@
  limitations under the License.
  */
 
+#include <limits.h>
+#include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
 #include <jni.h>
 #include <android/native_window_jni.h>
 #include <EGL/egl.h>
+#include "flowers_clock.h"
 #include "gl_thread.h"
+#include "log.h"
 
-// EXTERN define for JNI functions.
-#define FLOWERS_EXTERN(func) Java_fi_harism_wallpaper_flowersndk_FlowerService_ ## func
+// Java class native methods are registered to.
+#define FLOWERS_CLASS "fi/harism/wallpaper/flowersndk/FlowerService"
+
+// Whether EGL context is created and shaders compiled as soon as
+// first host connects instead of waiting for it to become visible.
+#ifndef FLOWERS_EAGER_START
+#define FLOWERS_EAGER_START GL_THREAD_TRUE
+#endif
+
+// Scene snapshot file name within application files directory.
+#define FLOWERS_SNAPSHOT_FILE "scene.snapshot"
 
 // UNUSED define for marking unused variables from generating errors.
 #define UNUSED __attribute__ ((unused))
 
-// Global host count.
+// Number of power of two microsecond buckets in latency histograms.
+// Last bucket collects everything from 2^14us (~16ms) upwards.
+#define FLOWERS_LATENCY_BUCKETS 15
+
+// Global host count. Hosts may connect and disconnect from
+// several threads, hence count is guarded with a mutex.
 int flowers_hostCount;
+pthread_mutex_t flowers_hostMutex = PTHREAD_MUTEX_INITIALIZER;
+
+// Full path of scene snapshot, empty until first host connects.
+// Guarded with host mutex.
+char flowers_snapshotPath[PATH_MAX];
+
+// JNI entry points latencies are tracked for.
+typedef enum {
+	FLOWERS_ENTRY_CONNECT,
+	FLOWERS_ENTRY_DISCONNECT,
+	FLOWERS_ENTRY_SET_PAUSED,
+	FLOWERS_ENTRY_SET_SURFACE,
+	FLOWERS_ENTRY_SET_SURFACE_SIZE,
+	FLOWERS_ENTRY_SET_COLORS,
+	FLOWERS_ENTRY_COUNT
+} flowers_entry_t;
+
+// Latency histogram for one entry point. Entry points block on render
+// thread lock, this shows how long UI thread ends up waiting for it.
+typedef struct {
+	uint32_t count;
+	flowers_nanos_t maxNanos;
+	uint32_t buckets[FLOWERS_LATENCY_BUCKETS];
+} flowers_latency_t;
+
+flowers_latency_t flowers_latency[FLOWERS_ENTRY_COUNT];
+
+// Time from render thread creation to its first frame on screen, taken
+// from last thread before it was destroyed. Guarded with host mutex.
+int32_t flowers_firstFrameMillis = -1;
+
+const char *flowers_entryNames[FLOWERS_ENTRY_COUNT] = { "connect",
+		"disconnect", "setPaused", "setSurface", "setSurfaceSize",
+		"setColors" };
 
 // Global thread callback functions struct.
 #define THREAD_FUNCS flowers_thread_funcs
@@ -36,7 +90,59 @@ gl_thread_funcs_t THREAD_FUNCS;
 // Render callback prototypes (flowers_renderer.c).
 void flowers_OnRenderFrame();
 void flowers_OnSurfaceChanged(int32_t width, int32_t height);
+void flowers_OnContextCreated();
+void flowers_OnContextDestroyed();
 void flowers_OnSurfaceCreated();
+void flowers_SceneSave(const char *path);
+void flowers_SceneRestore(const char *path);
+void flowers_LutBake(int scheme, uint32_t flower1, uint32_t flower2,
+		uint32_t bgTop, uint32_t bgBottom);
+
+// Adds time elapsed since startTime into entry point histogram.
+void flowers_LatencyAdd(flowers_entry_t entry, flowers_nanos_t startTime) {
+	flowers_latency_t *latency = &flowers_latency[entry];
+	flowers_nanos_t nanos = flowers_ClockNanos() - startTime;
+	flowers_nanos_t micros = nanos / 1000;
+	int bucket = 0;
+	while (micros > 1 && bucket < FLOWERS_LATENCY_BUCKETS - 1) {
+		micros >>= 1;
+		++bucket;
+	}
+	__sync_add_and_fetch(&latency->count, 1);
+	__sync_add_and_fetch(&latency->buckets[bucket], 1);
+	flowers_nanos_t maxNanos = __atomic_load_n(&latency->maxNanos,
+			__ATOMIC_RELAXED);
+	while (nanos > maxNanos && !__atomic_compare_exchange_n(
+			&latency->maxNanos, &maxNanos, nanos, 1, __ATOMIC_RELAXED,
+			__ATOMIC_RELAXED)) {
+	}
+}
+
+// Logs latency histograms collected since library was loaded.
+void flowers_LatencyLog() {
+	int entry, bucket;
+	LOGD("flowers_Latency", "first frame %dms, eager start %d",
+			flowers_firstFrameMillis, FLOWERS_EAGER_START);
+	for (entry = 0; entry < FLOWERS_ENTRY_COUNT; ++entry) {
+		flowers_latency_t *latency = &flowers_latency[entry];
+		if (latency->count == 0) {
+			continue;
+		}
+		LOGD("flowers_Latency", "%s count=%u max=%lldus", flowers_entryNames[entry],
+				latency->count, (long long) (latency->maxNanos / 1000));
+		for (bucket = 0; bucket < FLOWERS_LATENCY_BUCKETS; ++bucket) {
+			// Last bucket has no upper bound.
+			if (latency->buckets[bucket] && bucket < FLOWERS_LATENCY_BUCKETS - 1) {
+				LOGD("flowers_Latency", "%s <%dus: %u", flowers_entryNames[entry],
+						2 << bucket, latency->buckets[bucket]);
+			} else if (latency->buckets[bucket]) {
+				LOGD("flowers_Latency", "%s >=%dus: %u",
+						flowers_entryNames[entry], 1 << bucket,
+						latency->buckets[bucket]);
+			}
+		}
+	}
+}
 
 // EGLConfig chooser implementation.
 EGLConfig flowers_ChooseConfig(EGLDisplay display, EGLConfig* configArray,
@@ -69,45 +175,88 @@ EGLConfig flowers_ChooseConfig(EGLDisplay display, EGLConfig* configArray,
 	return retConfig;
 }
 
-// JNI function for notifying about new host.
-void FLOWERS_EXTERN(flowersConnect(UNUSED JNIEnv* env)) {
-	// If host count == 0, start rendering thread.
-	// Otherwise we expect it to be running already.
+// JNI function for notifying about new host. Scene snapshot
+// is kept in given files directory.
+void flowers_Connect(JNIEnv* env, UNUSED jobject obj, jstring filesDir) {
+	flowers_nanos_t startTime = flowers_ClockNanos();
+	pthread_mutex_lock(&flowers_hostMutex);
+	// If host count == 0, restore previous scene and start
+	// rendering thread. Otherwise we expect it to be running already.
 	if (flowers_hostCount == 0) {
+		const char *dir = (*env)->GetStringUTFChars(env, filesDir, NULL);
+		if (dir) {
+			snprintf(flowers_snapshotPath, sizeof flowers_snapshotPath,
+					"%s/%s", dir, FLOWERS_SNAPSHOT_FILE);
+			(*env)->ReleaseStringUTFChars(env, filesDir, dir);
+			flowers_SceneRestore(flowers_snapshotPath);
+		}
 		THREAD_FUNCS.chooseConfig = flowers_ChooseConfig;
 		THREAD_FUNCS.onRenderFrame = flowers_OnRenderFrame;
 		THREAD_FUNCS.onSurfaceChanged = flowers_OnSurfaceChanged;
+		THREAD_FUNCS.onContextCreated = flowers_OnContextCreated;
+		THREAD_FUNCS.onContextDestroyed = flowers_OnContextDestroyed;
 		THREAD_FUNCS.onSurfaceCreated = flowers_OnSurfaceCreated;
-		gl_ThreadCreate(&THREAD_FUNCS);
+		gl_ThreadCreate(&THREAD_FUNCS, FLOWERS_EAGER_START);
 	}
 	++flowers_hostCount;
+	pthread_mutex_unlock(&flowers_hostMutex);
+	flowers_LatencyAdd(FLOWERS_ENTRY_CONNECT, startTime);
 }
 
 // JNI function for notifying implementation about host
 // being destroyed.
-void FLOWERS_EXTERN(flowersDisconnect(UNUSED JNIEnv *env)) {
-	// If host count == 1, destroy rendering thread.
+void flowers_Disconnect(UNUSED JNIEnv *env, UNUSED jobject obj) {
+	flowers_nanos_t startTime = flowers_ClockNanos();
+	pthread_mutex_lock(&flowers_hostMutex);
+	// If host count == 1, destroy rendering thread and store
+	// scene for next connect.
 	if (flowers_hostCount == 1) {
+		flowers_firstFrameMillis = gl_ThreadGetFirstFrameMillis();
 		gl_ThreadDestroy();
+		if (flowers_snapshotPath[0]) {
+			flowers_SceneSave(flowers_snapshotPath);
+		}
 	}
 	if (flowers_hostCount > 0) {
 		--flowers_hostCount;
 	}
+	flowers_LatencyAdd(FLOWERS_ENTRY_DISCONNECT, startTime);
+	// Once last host is gone log latencies collected so far, see
+	// tools/gl_thread_stress.c for reporting them under load.
+	if (flowers_hostCount == 0) {
+		flowers_LatencyLog();
+	}
+	pthread_mutex_unlock(&flowers_hostMutex);
 }
 
 // JNI function for modifying render thread paused state.
-void FLOWERS_EXTERN(flowersSetPaused(UNUSED JNIEnv *env, UNUSED jobject obj, jboolean paused)) {
+void flowers_SetPaused(UNUSED JNIEnv *env, UNUSED jobject obj, jboolean paused) {
+	flowers_nanos_t startTime = flowers_ClockNanos();
 	// Update rendering thread paused state.
 	if (paused == JNI_TRUE) {
 		gl_ThreadSetPaused(GL_THREAD_TRUE);
+		// Process may get killed any time while we're paused, store
+		// scene while holding lock so that simulation can't step. Path
+		// is written by flowers_Connect under host mutex.
+		char path[PATH_MAX];
+		pthread_mutex_lock(&flowers_hostMutex);
+		memcpy(path, flowers_snapshotPath, sizeof path);
+		pthread_mutex_unlock(&flowers_hostMutex);
+		if (path[0]) {
+			gl_ThreadLock();
+			flowers_SceneSave(path);
+			gl_ThreadUnlock();
+		}
 	} else {
 		gl_ThreadSetPaused(GL_THREAD_FALSE);
 	}
+	flowers_LatencyAdd(FLOWERS_ENTRY_SET_PAUSED, startTime);
 }
 
 // JNI function for handling surface updates and deletion. Passing null to
 // will destroy current surface.
-void FLOWERS_EXTERN(flowersSetSurface(JNIEnv *env, UNUSED jobject obj, jobject surface)) {
+void flowers_SetSurface(JNIEnv *env, UNUSED jobject obj, jobject surface) {
+	flowers_nanos_t startTime = flowers_ClockNanos();
 	// Update rendering thread window.
 	if (surface) {
 		// Rendering thread takes ownership of ANativeWindow in a sense it
@@ -116,10 +265,53 @@ void FLOWERS_EXTERN(flowersSetSurface(JNIEnv *env, UNUSED jobject obj, jobject s
 	} else {
 		gl_ThreadSetWindow(NULL);
 	}
+	flowers_LatencyAdd(FLOWERS_ENTRY_SET_SURFACE, startTime);
 }
 
 // JNI function for handling surface size changed events.
-void FLOWERS_EXTERN(flowersSetSurfaceSize(UNUSED JNIEnv *env, UNUSED jobject obj, jint width, jint height)) {
+void flowers_SetSurfaceSize(UNUSED JNIEnv *env, UNUSED jobject obj, jint width, jint height) {
+	flowers_nanos_t startTime = flowers_ClockNanos();
 	// Update rendering thread window size.
 	gl_ThreadSetWindowSize(width, height);
+	flowers_LatencyAdd(FLOWERS_ENTRY_SET_SURFACE_SIZE, startTime);
+}
+
+// JNI function for updating color preferences. Colors are packed ARGB
+// values, predefined color scheme overrides them unless it's custom one.
+void flowers_SetColors(UNUSED JNIEnv *env, UNUSED jobject obj, jint scheme,
+		jint flower1, jint flower2, jint bgTop, jint bgBottom) {
+	flowers_nanos_t startTime = flowers_ClockNanos();
+	// Lookup textures are baked right away, rendering
+	// thread only uploads them on next frame.
+	gl_ThreadLock();
+	flowers_LutBake(scheme, flower1, flower2, bgTop, bgBottom);
+	gl_ThreadUnlock();
+	flowers_LatencyAdd(FLOWERS_ENTRY_SET_COLORS, startTime);
+}
+
+// Native methods table for FLOWERS_CLASS.
+static const JNINativeMethod flowers_methods[] = {
+		{ "flowersConnect", "(Ljava/lang/String;)V", (void*) flowers_Connect },
+		{ "flowersDisconnect", "()V", (void*) flowers_Disconnect },
+		{ "flowersSetPaused", "(Z)V", (void*) flowers_SetPaused },
+		{ "flowersSetSurface", "(Landroid/view/Surface;)V",
+				(void*) flowers_SetSurface },
+		{ "flowersSetSurfaceSize", "(II)V", (void*) flowers_SetSurfaceSize },
+		{ "flowersSetColors", "(IIIII)V", (void*) flowers_SetColors } };
+
+// Registers native methods directly once library is loaded. This saves
+// runtime from doing symbol lookups on first call of each method.
+JNIEXPORT jint JNICALL JNI_OnLoad(JavaVM *vm, UNUSED void *reserved) {
+	JNIEnv *env;
+	if ((*vm)->GetEnv(vm, (void**) &env, JNI_VERSION_1_4) != JNI_OK) {
+		return JNI_ERR;
+	}
+	jclass clazz = (*env)->FindClass(env, FLOWERS_CLASS);
+	if (clazz == NULL) {
+		return JNI_ERR;
+	}
+	jint ret = (*env)->RegisterNatives(env, clazz, flowers_methods,
+			sizeof flowers_methods / sizeof flowers_methods[0]);
+	(*env)->DeleteLocalRef(env, clazz);
+	return ret == JNI_OK ? JNI_VERSION_1_4 : JNI_ERR;
 }
@@ -1,85 +1,332 @@
+#include <stddef.h>
 #include <stdlib.h>
+#include <string.h>
 #include <time.h>
 #include <math.h>
 #include <GLES2/gl2.h>
 #include "gl_utils.h"
+#include "gl_sprite.h"
+#include "gl_vertex.h"
+#include "gl_capture.h"
+#include "flowers_clock.h"
+#include "flowers_color.h"
 #include "flowers_shaders.h"
+#include "flowers_snapshot.h"
+#include "log.h"
 
-typedef unsigned long long flowers_time_t;
+// Number of frames between GL state statistics log entries.
+#define FLOWERS_STATS_INTERVAL 300
+
+// Number of flower heads and different head textures.
+#define FLOWERS_FLOWER_COUNT 8
+#define FLOWERS_TEXTURE_COUNT 4
+#define FLOWERS_TEXTURE_SIZE 60
+#define FLOWERS_ATLAS_SIZE 128
+
+// Simulation rate, maximum number of ticks simulated per frame
+// and number of ticks it takes to move to new offset target.
+#define FLOWERS_TICK_HZ 30
+#define FLOWERS_TICK_MAX 10
+#define FLOWERS_OFFSET_TICKS (5 * FLOWERS_TICK_HZ)
+
+// Version of flowers_scene_t layout stored in snapshots. Has to be
+// increased whenever scene struct or anything it contains changes.
+#define FLOWERS_SCENE_VERSION 2
+
+// Size of buffer vertex shader sources are generated into.
+#define FLOWERS_SHADER_SIZE 1024
+
+// Width of color lookup textures, number of flower palettes and
+// scheme used until colors are set from preferences.
+#define FLOWERS_LUT_SIZE 64
+#define FLOWERS_PALETTE_COUNT 2
+#define FLOWERS_COLOR_SCHEME_DEFAULT FLOWERS_COLOR_SCHEME_SUMMER
+
+// Texture units lookup textures are bound to, atlas uses unit 0.
+#define FLOWERS_UNIT_GRADIENT 1
+#define FLOWERS_UNIT_PALETTE 2
+
+// Define FLOWERS_BENCHMARK to cycle flower count from 1 to GL_SPRITE_MAX,
+// doubling it every FLOWERS_STATS_INTERVAL frames, for logging
+// draw call and upload byte counts.
 
 typedef struct {
 	GLfloat x;
 	GLfloat y;
 } flowers_point_t;
 
+// Background vertex with byte positions, padded to four bytes.
 typedef struct {
-	GLfloat r;
-	GLfloat g;
-	GLfloat b;
-	GLfloat a;
-} flowers_color_t;
+	GLbyte x;
+	GLbyte y;
+	GLbyte padding[2];
+} flowers_bg_vertex_t;
 
-#define GLOBALS flowers_renderer_globals
 typedef struct {
-	flowers_time_t offsetTime;
+	flowers_point_t position;
+	int palette;
+	GLfloat scale;
+	GLfloat rotation;
+	GLfloat rotationSpeed;
+	int textureIndex;
+} flowers_flower_t;
+
+// Simulation state, everything needed for continuing animation where
+// it was left. Stored as is into snapshots, hence no pointers here.
+typedef struct {
+	flowers_clock_t clock;
+	uint32_t random;
+	int32_t offsetTicks;
 	flowers_point_t offsetSource;
 	flowers_point_t offsetTarget;
+	flowers_point_t offset;
+	flowers_point_t offsetPrev;
+	flowers_flower_t flowers[GL_SPRITE_MAX];
+	int flowerCount;
+} flowers_scene_t;
+
+#define GLOBALS flowers_renderer_globals
+typedef struct {
+	flowers_scene_t scene;
+	int sceneValid;
 	flowers_point_t aspectRatio;
 	flowers_point_t lineWidth;
 	gl_utils_program_t program_bg;
+	GLint program_bg_uOffset;
+	GLint program_bg_uAspectRatio;
+	GLint program_bg_uLineWidth;
+	GLint program_bg_sGradient;
+	GLint program_bg_attribs[GL_VERTEX_ATTRIB_MAX];
+	gl_vertex_format_t format_bg;
+	gl_utils_program_t program_sprite;
+	GLint program_sprite_sTexture;
+	GLint program_sprite_sPalette;
+	GLint program_sprite_uPaletteCount;
+	GLint program_sprite_attribs[GL_VERTEX_ATTRIB_MAX];
+	gl_vertex_format_t format_sprite;
+	gl_sprite_atlas_t atlas;
+	gl_sprite_region_t textures[FLOWERS_TEXTURE_COUNT];
+	gl_sprite_batch_t batch;
+	GLubyte gradientPixels[FLOWERS_LUT_SIZE * 4];
+	GLubyte palettePixels[FLOWERS_LUT_SIZE * FLOWERS_PALETTE_COUNT * 4];
+	int colorsBaked;
+	int colorsChanged;
+	GLuint gradientTexture;
+	GLuint paletteTexture;
+	int lutUploaded;
+	gl_utils_stats_t glStats;
+	gl_sprite_stats_t spriteStats;
+	unsigned int frameCount;
 } flowers_renderer_globals_t;
 flowers_renderer_globals_t GLOBALS;
 
-flowers_time_t flowers_CurrentTimeMillis() {
-	struct timespec ts;
-	clock_gettime(CLOCK_REALTIME, &ts);
-	return ts.tv_sec * 1000 + (ts.tv_nsec / 1000000);
+// Returns next pseudo random value in range [0, 2^32). Generator state
+// is part of scene so restored scene continues same sequence.
+uint32_t flowers_Random(flowers_scene_t *scene) {
+	uint32_t x = scene->random;
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	return scene->random = x;
 }
 
-void flowers_OnRenderFrame() {
-
-	// Update offset.
-	flowers_time_t currentTime = flowers_CurrentTimeMillis();
+// Steps simulation forward by one tick.
+void flowers_SimulationStep(flowers_scene_t *scene, GLfloat tickSeconds) {
+	scene->offsetPrev = scene->offset;
 	// If time passed generate new target.
-	if (currentTime - GLOBALS.offsetTime > 5000) {
-		GLOBALS.offsetTime = currentTime;
-		memcpy(&GLOBALS.offsetSource, &GLOBALS.offsetTarget,
-				sizeof GLOBALS.offsetSource);
-		GLOBALS.offsetTarget.x = ((rand() % 2048) / 1024.f) - 1.f;
-		GLOBALS.offsetTarget.y = ((rand() % 2048) / 1024.f) - 1.f;
+	if (++scene->offsetTicks > FLOWERS_OFFSET_TICKS) {
+		scene->offsetTicks = 0;
+		memcpy(&scene->offsetSource, &scene->offsetTarget,
+				sizeof scene->offsetSource);
+		scene->offsetTarget.x = ((flowers_Random(scene) % 2048) / 1024.f) - 1.f;
+		scene->offsetTarget.y = ((flowers_Random(scene) % 2048) / 1024.f) - 1.f;
 	}
 
-	// Calculate final offset values.
-	float t = (currentTime - GLOBALS.offsetTime) / 5000.f;
+	// Calculate offset values.
+	float t = (float) scene->offsetTicks / FLOWERS_OFFSET_TICKS;
 	t = t * t * (3 - 2 * t);
+	scene->offset.x = scene->offsetSource.x
+			+ t * (scene->offsetTarget.x - scene->offsetSource.x);
+	scene->offset.y = scene->offsetSource.y
+			+ t * (scene->offsetTarget.y - scene->offsetSource.y);
+
+	int idx;
+	for (idx = 0; idx < GL_SPRITE_MAX; ++idx) {
+		flowers_flower_t *flower = &scene->flowers[idx];
+		flower->rotation = fmodf(
+				flower->rotation + flower->rotationSpeed * tickSeconds,
+				2 * M_PI);
+	}
+}
+
+// Bakes color lookup textures for given scheme, colors are packed ARGB
+// values used with custom scheme. Caller has to hold rendering thread
+// lock, textures are uploaded by rendering thread on next frame.
+void flowers_LutBake(int scheme, uint32_t flower1, uint32_t flower2,
+		uint32_t bgTop, uint32_t bgBottom) {
+	flowers_color_scheme_t colors = { flower1, flower2, bgTop, bgBottom };
+	flowers_ColorSchemePreset(scheme, &colors);
+	flowers_ColorBakeGradient(colors.bgTop, colors.bgBottom,
+			GLOBALS.gradientPixels, FLOWERS_LUT_SIZE);
+	// Palettes map flower head texture value to color, from
+	// transparent at zero to full flower color at one. Only alpha
+	// fades, texels aren't premultiplied as blending multiplies
+	// with alpha already and darker color would show as fringes.
+	flowers_ColorBakeGradient(colors.flower1 & 0x00FFFFFF, colors.flower1,
+			GLOBALS.palettePixels, FLOWERS_LUT_SIZE);
+	flowers_ColorBakeGradient(colors.flower2 & 0x00FFFFFF, colors.flower2,
+			GLOBALS.palettePixels + FLOWERS_LUT_SIZE * 4, FLOWERS_LUT_SIZE);
+	GLOBALS.colorsBaked = 1;
+	GLOBALS.colorsChanged = 1;
+}
+
+// Creates empty RGBA lookup texture of given size.
+GLuint flowers_LutCreate(GLenum unit, GLsizei width, GLsizei height) {
+	GLuint texture;
+	glGenTextures(1, &texture);
+	gl_StateActiveTexture(unit);
+	gl_StateBindTexture(texture);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA,
+			GL_UNSIGNED_BYTE, NULL);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	return texture;
+}
+
+// Uploads lookup textures if colors have changed or context was
+// recreated. Shaders stay as they are, only texels are replaced.
+void flowers_LutUpdate() {
+	if (!GLOBALS.colorsBaked) {
+		flowers_LutBake(FLOWERS_COLOR_SCHEME_DEFAULT, 0, 0, 0, 0);
+	}
+	if (GLOBALS.colorsChanged || !GLOBALS.lutUploaded) {
+		gl_StateActiveTexture(GL_TEXTURE0 + FLOWERS_UNIT_GRADIENT);
+		gl_StateBindTexture(GLOBALS.gradientTexture);
+		glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, FLOWERS_LUT_SIZE, 1, GL_RGBA,
+				GL_UNSIGNED_BYTE, GLOBALS.gradientPixels);
+		gl_StateActiveTexture(GL_TEXTURE0 + FLOWERS_UNIT_PALETTE);
+		gl_StateBindTexture(GLOBALS.paletteTexture);
+		glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, FLOWERS_LUT_SIZE,
+				FLOWERS_PALETTE_COUNT, GL_RGBA, GL_UNSIGNED_BYTE,
+				GLOBALS.palettePixels);
+		GLOBALS.colorsChanged = 0;
+		GLOBALS.lutUploaded = 1;
+	}
+}
+
+// Wraps value into range [-range, range).
+GLfloat flowers_Wrap(GLfloat value, GLfloat range) {
+	value = fmodf(value + range, 2 * range);
+	if (value < 0) {
+		value += 2 * range;
+	}
+	return value - range;
+}
+
+// Renders single channel flower head image with given petal count.
+void flowers_GenerateTexture(GLubyte *pixels, int size, int petals) {
+	int x, y;
+	for (y = 0; y < size; ++y) {
+		for (x = 0; x < size; ++x) {
+			GLfloat dx = (x + .5f) / size * 2 - 1;
+			GLfloat dy = (y + .5f) / size * 2 - 1;
+			GLfloat dist = sqrtf(dx * dx + dy * dy);
+			GLfloat petal = .6f + .38f * fabsf(cosf(atan2f(dy, dx) * petals * .5f));
+			// Anti-aliased edge of roughly one pixel.
+			GLfloat value = (petal - dist) * size * .5f;
+			value = value < 0 ? 0 : value > 1 ? 1 : value;
+			// Darker center.
+			if (dist < .25f) {
+				value *= .6f;
+			}
+			pixels[y * size + x] = value * 255;
+		}
+	}
+}
+
+void flowers_OnRenderFrame() {
+	flowers_scene_t *scene = &GLOBALS.scene;
+
+	// Collect GL state and sprite statistics from previous frame.
+	gl_StateFrameBegin(&GLOBALS.glStats);
+	gl_SpriteBatchBegin(&GLOBALS.batch, &GLOBALS.spriteStats);
+	if (++GLOBALS.frameCount % FLOWERS_STATS_INTERVAL == 0) {
+		LOGD("flowers_OnRenderFrame",
+				"gl calls issued=%u skipped=%u sprites=%u draws=%u upload=%u bytes",
+				GLOBALS.glStats.issued, GLOBALS.glStats.skipped,
+				GLOBALS.spriteStats.sprites, GLOBALS.spriteStats.drawCalls,
+				GLOBALS.spriteStats.uploadBytes);
+#ifdef FLOWERS_BENCHMARK
+		scene->flowerCount = scene->flowerCount < GL_SPRITE_MAX ?
+				scene->flowerCount * 2 : 1;
+#endif
+	}
+
+	// Step simulation with fixed ticks and interpolate
+	// render state between two latest ticks.
+	GLfloat tickSeconds = flowers_ClockTickSeconds(&scene->clock);
+	int32_t ticks = flowers_ClockAdvance(&scene->clock);
+	while (ticks-- > 0) {
+		flowers_SimulationStep(scene, tickSeconds);
+	}
+	GLfloat alpha = scene->clock.alpha;
 
 	flowers_point_t offset;
-	offset.x = GLOBALS.offsetSource.x
-			+ t * (GLOBALS.offsetTarget.x - GLOBALS.offsetSource.x);
-	offset.y = GLOBALS.offsetSource.y
-			+ t * (GLOBALS.offsetTarget.y - GLOBALS.offsetSource.y);
+	offset.x = scene->offsetPrev.x
+			+ alpha * (scene->offset.x - scene->offsetPrev.x);
+	offset.y = scene->offsetPrev.y
+			+ alpha * (scene->offset.y - scene->offsetPrev.y);
 
-	GLuint program = GLOBALS.program_bg.program;
-	GLint uOffset = gl_ProgramGetLocation(program, "uOffset");
-	GLint uAspectRatio = gl_ProgramGetLocation(program, "uAspectRatio");
-	GLint uLineWidth = gl_ProgramGetLocation(program, "uLineWidth");
-	GLint aPosition = gl_ProgramGetLocation(program, "aPosition");
-	GLint aColor = gl_ProgramGetLocation(program, "aColor");
-
-	glUseProgram(program);
-	glUniform2f(uOffset, offset.x, offset.y);
-	glUniform2f(uAspectRatio, GLOBALS.aspectRatio.x, GLOBALS.aspectRatio.y);
-	glUniform2f(uLineWidth, GLOBALS.lineWidth.x, GLOBALS.lineWidth.y);
-
-	GLbyte vertices[] = { -1, 1, -1, -1, 1, 1, 1, -1 };
-	GLfloat colors[] = { .8f, 0.f, 0.f, 0.f, .8f, 0.f, 0.f, 0.f, .8f, .8f, .8f,
-			0.f };
-
-	glVertexAttribPointer(aPosition, 2, GL_BYTE, GL_FALSE, 0, &vertices);
-	glEnableVertexAttribArray(aPosition);
-	glVertexAttribPointer(aColor, 3, GL_FLOAT, GL_FALSE, 0, &colors);
-	glEnableVertexAttribArray(aColor);
+	flowers_LutUpdate();
+
+	gl_StateSetBlend(GL_FALSE);
+	gl_StateUseProgram(GLOBALS.program_bg.program);
+	gl_StateUniform1i(GLOBALS.program_bg_sGradient, FLOWERS_UNIT_GRADIENT);
+	gl_StateUniform2f(GLOBALS.program_bg_uOffset, offset.x, offset.y);
+	gl_StateUniform2f(GLOBALS.program_bg_uAspectRatio, GLOBALS.aspectRatio.x,
+			GLOBALS.aspectRatio.y);
+	gl_StateUniform2f(GLOBALS.program_bg_uLineWidth, GLOBALS.lineWidth.x,
+			GLOBALS.lineWidth.y);
+
+	const flowers_bg_vertex_t vertices[] = { { -1, 1, { 0 } },
+			{ -1, -1, { 0 } }, { 1, 1, { 0 } }, { 1, -1, { 0 } } };
+
+	gl_StateBindBuffer(GL_ARRAY_BUFFER, 0);
+	gl_VertexFormatBind(&GLOBALS.format_bg, GLOBALS.program_bg_attribs,
+			vertices);
 	glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+
+	// Write all flower heads into sprite batch and draw them at once.
+	// Rotation is linear so it's interpolated back from latest tick.
+	// Red channel of sprite color carries palette index.
+	GLfloat rewind = (alpha - 1.f) * tickSeconds;
+	int idx;
+	for (idx = 0; idx < scene->flowerCount; ++idx) {
+		flowers_flower_t *flower = &scene->flowers[idx];
+		GLfloat x = flowers_Wrap(flower->position.x - offset.x, 1.2f);
+		GLfloat y = flowers_Wrap(flower->position.y - offset.y, 1.2f);
+		gl_SpriteBatchAdd(&GLOBALS.batch, &GLOBALS.textures[flower->textureIndex],
+				x, y, flower->scale * GLOBALS.aspectRatio.y,
+				flower->scale * GLOBALS.aspectRatio.x,
+				flower->rotation + flower->rotationSpeed * rewind,
+				flower->palette / 255.f, 0.f, 0.f, 1.f);
+	}
+
+	gl_StateSetBlend(GL_TRUE);
+	gl_StateBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	gl_StateUseProgram(GLOBALS.program_sprite.program);
+	gl_StateUniform1i(GLOBALS.program_sprite_sTexture, 0);
+	gl_StateUniform1i(GLOBALS.program_sprite_sPalette, FLOWERS_UNIT_PALETTE);
+	gl_StateUniform1f(GLOBALS.program_sprite_uPaletteCount,
+			FLOWERS_PALETTE_COUNT);
+	gl_StateActiveTexture(GL_TEXTURE0);
+	gl_StateBindTexture(GLOBALS.atlas.texture);
+	gl_SpriteBatchFlush(&GLOBALS.batch, &GLOBALS.format_sprite,
+			GLOBALS.program_sprite_attribs);
+
+	gl_CaptureFrameEnd();
 }
 
 void flowers_OnSurfaceChanged(int32_t width, int32_t height) {
@@ -91,14 +338,201 @@ void flowers_OnSurfaceChanged(int32_t width, int32_t height) {
 	GLOBALS.lineWidth.y = GLOBALS.aspectRatio.y * 40.f / height;
 }
 
+// Generates new scene from scratch.
+void flowers_SceneInit(flowers_scene_t *scene) {
+	// Zero is a fixed point for xorshift, avoid it.
+	scene->random = time(NULL) | 1;
+
+	flowers_ClockInit(&scene->clock, 1000000000LL / FLOWERS_TICK_HZ,
+			FLOWERS_TICK_MAX);
+	scene->offsetTicks = 0;
+	memset(&scene->offset, 0, sizeof scene->offset);
+	memset(&scene->offsetPrev, 0, sizeof scene->offsetPrev);
+	memset(&scene->offsetSource, 0, sizeof scene->offsetSource);
+	scene->offsetTarget.x = ((flowers_Random(scene) % 2048) / 1024.f) - 1.f;
+	scene->offsetTarget.y = ((flowers_Random(scene) % 2048) / 1024.f) - 1.f;
+
+	// Randomize flower heads.
+#ifdef FLOWERS_BENCHMARK
+	scene->flowerCount = 1;
+#else
+	scene->flowerCount = FLOWERS_FLOWER_COUNT;
+#endif
+	int idx;
+	for (idx = 0; idx < GL_SPRITE_MAX; ++idx) {
+		flowers_flower_t *flower = &scene->flowers[idx];
+		flower->position.x = ((flowers_Random(scene) % 2048) / 1024.f) - 1.f;
+		flower->position.y = ((flowers_Random(scene) % 2048) / 1024.f) - 1.f;
+		flower->scale = .1f + (flowers_Random(scene) % 1024) / 10240.f;
+		flower->rotation = (flowers_Random(scene) % 1024) / 1024.f * 2 * M_PI;
+		flower->rotationSpeed = ((flowers_Random(scene) % 1024) / 1024.f - .5f);
+		flower->textureIndex = idx % FLOWERS_TEXTURE_COUNT;
+		flower->palette = idx % FLOWERS_PALETTE_COUNT;
+	}
+}
+
+// Queues current scene to be written into snapshot file. Only copies
+// scene, file is written on snapshot writer thread. Caller has to make
+// sure rendering thread isn't running simulation meanwhile.
+void flowers_SceneSave(const char *path) {
+	if (GLOBALS.sceneValid
+			&& flowers_SnapshotWriteAsync(path, FLOWERS_SCENE_VERSION,
+					&GLOBALS.scene, sizeof GLOBALS.scene) != 0) {
+		LOGW("flowers_SceneSave", "failed to queue %s", path);
+	}
+}
+
+// Returns non-zero if both point coordinates are finite.
+int flowers_PointFinite(const flowers_point_t *point) {
+	return isfinite(point->x) && isfinite(point->y);
+}
+
+// Checks scene read from snapshot file can be used as is. Values used
+// as counts or indices have to be in range and floats finite, file may
+// be stale or corrupted.
+int flowers_SceneValidate(const flowers_scene_t *scene) {
+	if (scene->flowerCount < 0 || scene->flowerCount > GL_SPRITE_MAX
+			|| scene->offsetTicks < 0
+			|| scene->offsetTicks > FLOWERS_OFFSET_TICKS
+			|| !flowers_PointFinite(&scene->offsetSource)
+			|| !flowers_PointFinite(&scene->offsetTarget)
+			|| !flowers_PointFinite(&scene->offset)
+			|| !flowers_PointFinite(&scene->offsetPrev)) {
+		return 0;
+	}
+	int idx;
+	for (idx = 0; idx < GL_SPRITE_MAX; ++idx) {
+		const flowers_flower_t *flower = &scene->flowers[idx];
+		if (flower->textureIndex < 0
+				|| flower->textureIndex >= FLOWERS_TEXTURE_COUNT
+				|| flower->palette < 0
+				|| flower->palette >= FLOWERS_PALETTE_COUNT
+				|| !flowers_PointFinite(&flower->position)
+				|| !isfinite(flower->scale) || !isfinite(flower->rotation)
+				|| !isfinite(flower->rotationSpeed)) {
+			return 0;
+		}
+	}
+	return 1;
+}
+
+// Adopts scene from snapshot file if there's a compatible one. Must
+// be called while rendering thread isn't running.
+void flowers_SceneRestore(const char *path) {
+	// Let previously queued save land first.
+	flowers_SnapshotWait();
+	const flowers_scene_t *scene = flowers_SnapshotMap(path,
+			FLOWERS_SCENE_VERSION, sizeof GLOBALS.scene);
+	if (scene) {
+		memcpy(&GLOBALS.scene, scene, sizeof GLOBALS.scene);
+		flowers_SnapshotUnmap(scene, sizeof GLOBALS.scene);
+		// Tick length and limit are build constants, not state. Never
+		// trust stored ones, they'd decide how long a frame may take.
+		flowers_ClockInit(&GLOBALS.scene.clock, 1000000000LL / FLOWERS_TICK_HZ,
+				FLOWERS_TICK_MAX);
+		GLOBALS.sceneValid = flowers_SceneValidate(&GLOBALS.scene);
+		if (!GLOBALS.sceneValid) {
+			LOGW("flowers_SceneRestore", "discarding invalid %s", path);
+		}
+	}
+}
+
 void flowers_OnSurfaceCreated() {
-	srand(time(NULL));
+	// Keep animating existing scene, its clock only needs to
+	// forget time spent without surface.
+	if (GLOBALS.sceneValid) {
+		flowers_ClockReset(&GLOBALS.scene.clock);
+	} else {
+		flowers_SceneInit(&GLOBALS.scene);
+		GLOBALS.sceneValid = 1;
+	}
+}
+
+void flowers_OnContextCreated() {
+	// New context, shadowed state is void.
+	gl_StateReset();
+	// Start recording GL commands when built with GL_CAPTURE.
+	gl_CaptureStart(GL_CAPTURE_PATH);
 
-	GLOBALS.offsetTime = flowers_CurrentTimeMillis();
-	GLOBALS.offsetTarget.x = ((rand() % 2048) / 1024.f) - 1.f;
-	GLOBALS.offsetTarget.y = ((rand() % 2048) / 1024.f) - 1.f;
+	GLchar vs[FLOWERS_SHADER_SIZE];
 
-	GLchar bg_vs[] = FLOWERS_BACKGROUND_VS;
+	gl_VertexFormatInit(&GLOBALS.format_bg, sizeof(flowers_bg_vertex_t));
+	gl_VertexFormatAdd(&GLOBALS.format_bg, "aPosition", 2, GL_BYTE, GL_FALSE,
+			offsetof(flowers_bg_vertex_t, x), NULL, NULL);
+	// Truncated shader source is left uncompiled, which leaves program
+	// zeroed the same way as failed compile or link would.
 	GLchar bg_fs[] = FLOWERS_BACKGROUND_FS;
-	gl_ProgramCreate(&GLOBALS.program_bg, bg_vs, bg_fs);
+	if (gl_VertexFormatShader(&GLOBALS.format_bg, FLOWERS_BACKGROUND_VS, vs,
+			sizeof vs)) {
+		gl_ProgramCreate(&GLOBALS.program_bg, vs, bg_fs);
+	} else {
+		LOGE("flowers_OnContextCreated", "background shader too long");
+	}
+
+	// Lookup locations once instead of querying them every frame.
+	GLuint program = GLOBALS.program_bg.program;
+	GLOBALS.program_bg_uOffset = gl_ProgramGetLocation(program, "uOffset");
+	GLOBALS.program_bg_uAspectRatio = gl_ProgramGetLocation(program,
+			"uAspectRatio");
+	GLOBALS.program_bg_uLineWidth = gl_ProgramGetLocation(program,
+			"uLineWidth");
+	GLOBALS.program_bg_sGradient = gl_ProgramGetLocation(program,
+			"sGradient");
+	gl_VertexFormatLocations(&GLOBALS.format_bg, program,
+			GLOBALS.program_bg_attribs);
+
+	gl_SpriteVertexFormat(&GLOBALS.format_sprite);
+	GLchar sprite_fs[] = FLOWERS_SPRITE_FS;
+	if (gl_VertexFormatShader(&GLOBALS.format_sprite, FLOWERS_SPRITE_VS, vs,
+			sizeof vs)) {
+		gl_ProgramCreate(&GLOBALS.program_sprite, vs, sprite_fs);
+	} else {
+		LOGE("flowers_OnContextCreated", "sprite shader too long");
+	}
+	program = GLOBALS.program_sprite.program;
+	GLOBALS.program_sprite_sTexture = gl_ProgramGetLocation(program,
+			"sTexture");
+	GLOBALS.program_sprite_sPalette = gl_ProgramGetLocation(program,
+			"sPalette");
+	GLOBALS.program_sprite_uPaletteCount = gl_ProgramGetLocation(program,
+			"uPaletteCount");
+	gl_VertexFormatLocations(&GLOBALS.format_sprite, program,
+			GLOBALS.program_sprite_attribs);
+
+	// Pack all flower head textures into one atlas.
+	GLubyte pixels[FLOWERS_TEXTURE_SIZE * FLOWERS_TEXTURE_SIZE];
+	gl_SpriteAtlasCreate(&GLOBALS.atlas, FLOWERS_ATLAS_SIZE,
+			FLOWERS_ATLAS_SIZE);
+	int idx;
+	for (idx = 0; idx < FLOWERS_TEXTURE_COUNT; ++idx) {
+		flowers_GenerateTexture(pixels, FLOWERS_TEXTURE_SIZE, 5 + idx);
+		gl_SpriteAtlasAdd(&GLOBALS.atlas, FLOWERS_TEXTURE_SIZE,
+				FLOWERS_TEXTURE_SIZE, pixels, &GLOBALS.textures[idx]);
+	}
+	gl_SpriteAtlasUpload(&GLOBALS.atlas);
+
+	gl_SpriteBatchCreate(&GLOBALS.batch);
+
+	// Color lookup textures get their texels on first frame.
+	GLOBALS.gradientTexture = flowers_LutCreate(
+			GL_TEXTURE0 + FLOWERS_UNIT_GRADIENT, FLOWERS_LUT_SIZE, 1);
+	GLOBALS.paletteTexture = flowers_LutCreate(
+			GL_TEXTURE0 + FLOWERS_UNIT_PALETTE, FLOWERS_LUT_SIZE,
+			FLOWERS_PALETTE_COUNT);
+	GLOBALS.lutUploaded = 0;
+}
+
+void flowers_OnContextDestroyed() {
+	gl_StateForgetTexture(GLOBALS.gradientTexture);
+	gl_StateForgetTexture(GLOBALS.paletteTexture);
+	glDeleteTextures(1, &GLOBALS.gradientTexture);
+	glDeleteTextures(1, &GLOBALS.paletteTexture);
+	GLOBALS.gradientTexture = 0;
+	GLOBALS.paletteTexture = 0;
+	GLOBALS.lutUploaded = 0;
+
+	gl_SpriteBatchRelease(&GLOBALS.batch);
+	gl_SpriteAtlasRelease(&GLOBALS.atlas);
+	gl_ProgramRelease(&GLOBALS.program_sprite);
+	gl_ProgramRelease(&GLOBALS.program_bg);
 }
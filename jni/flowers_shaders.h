@@ -1,30 +1,62 @@
 #ifndef FLOWERS_SHADERS_H__
 #define FLOWERS_SHADERS_H__
 
+// Vertex shaders come without attribute declarations,
+// these are generated with gl_VertexFormatShader. Colors
+// come from lookup textures baked by flowers_color.c.
+
 #define FLOWERS_BACKGROUND_VS " \
 uniform vec2 uOffset; \
 uniform vec2 uAspectRatio; \
-attribute vec2 aPosition; \
-attribute vec3 aColor; \
-varying vec3 vColor; \
+varying vec2 vGradient; \
 varying vec2 vPosition; \
 void main() { \
     gl_Position = vec4(aPosition, 0.0, 1.0); \
-    vColor = aColor; \
+    vGradient = vec2(0.5 - 0.5 * aPosition.y, 0.5); \
     vPosition = (aPosition + uOffset) * uAspectRatio * 10.0; \
 } "
 
 #define FLOWERS_BACKGROUND_FS " \
 precision mediump float; \
 uniform vec2 uLineWidth; \
-varying vec3 vColor; \
+uniform sampler2D sGradient; \
+varying vec2 vGradient; \
 varying vec2 vPosition; \
 void main() { \
-    gl_FragColor = vec4(vColor, 1.0); \
+    gl_FragColor = vec4(texture2D(sGradient, vGradient).rgb, 1.0); \
     vec2 f = fract(vPosition); \
     if (f.x < uLineWidth.x || f.y < uLineWidth.y) { \
         gl_FragColor.rgb *= 0.98; \
     } \
 } "
 
+// Sprite color red channel holds palette index as a
+// normalized byte, it's rounded back to an integer and
+// mapped to row centre so that LUT filtering never mixes
+// neighbouring rows. Alpha is applied on top of palette
+// alpha.
+#define FLOWERS_SPRITE_VS " \
+uniform float uPaletteCount; \
+varying vec2 vTextureCoord; \
+varying float vPalette; \
+varying float vAlpha; \
+void main() { \
+    gl_Position = vec4(aPosition, 0.0, 1.0); \
+    vTextureCoord = aTextureCoord; \
+    vPalette = (floor(aColor.r * 255.0 + 0.5) + 0.5) / uPaletteCount; \
+    vAlpha = aColor.a; \
+} "
+
+#define FLOWERS_SPRITE_FS " \
+precision mediump float; \
+uniform sampler2D sTexture; \
+uniform sampler2D sPalette; \
+varying vec2 vTextureCoord; \
+varying float vPalette; \
+varying float vAlpha; \
+void main() { \
+    float value = texture2D(sTexture, vTextureCoord).r; \
+    gl_FragColor = texture2D(sPalette, vec2(value, vPalette)) * vAlpha; \
+} "
+
 #endif
@@ -0,0 +1,208 @@
+/*
+ Copyright 2012 Harri Smtt
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+ */
+
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "flowers_snapshot.h"
+#include "log.h"
+
+// Pending asynchronous write, guarded by flowers_snapshotMutex. Writer
+// thread is started on first request and stays blocked while idle.
+#define GLOBALS flowers_snapshot_globals
+struct {
+	pthread_t thread;
+	int threadCreated;
+	int pending;
+	int writing;
+	char path[PATH_MAX];
+	uint32_t version;
+	void *data;
+	size_t size;
+} GLOBALS;
+
+pthread_mutex_t flowers_snapshotMutex = PTHREAD_MUTEX_INITIALIZER;
+pthread_cond_t flowers_snapshotCond = PTHREAD_COND_INITIALIZER;
+
+// Writes whole buffer, retrying short writes. Returns zero on success.
+int flowers_SnapshotWriteAll(int fd, const void *data, size_t size) {
+	const char *ptr = data;
+	while (size > 0) {
+		ssize_t written = write(fd, ptr, size);
+		if (written < 0 && errno == EINTR) {
+			continue;
+		}
+		if (written <= 0) {
+			return -1;
+		}
+		ptr += written;
+		size -= written;
+	}
+	return 0;
+}
+
+int flowers_SnapshotWrite(const char *path, uint32_t version,
+		const void *data, size_t size) {
+	char tmpPath[PATH_MAX];
+	if (snprintf(tmpPath, sizeof tmpPath, "%s.tmp", path) >= PATH_MAX) {
+		return -1;
+	}
+	int fd = open(tmpPath, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+	if (fd < 0) {
+		return -1;
+	}
+
+	flowers_snapshot_header_t header;
+	header.magic = FLOWERS_SNAPSHOT_MAGIC;
+	header.version = version;
+	header.size = size;
+	header.reserved = 0;
+	// Plain writes report full disk as an error, and file contents have
+	// to reach storage before rename makes them visible under path.
+	if (flowers_SnapshotWriteAll(fd, &header, sizeof header) != 0
+			|| flowers_SnapshotWriteAll(fd, data, size) != 0
+			|| fsync(fd) != 0) {
+		close(fd);
+		unlink(tmpPath);
+		return -1;
+	}
+	close(fd);
+
+	// Replace previous snapshot atomically.
+	if (rename(tmpPath, path) != 0) {
+		unlink(tmpPath);
+		return -1;
+	}
+	return 0;
+}
+
+// Writer thread function, writes queued snapshots one at a time.
+void* flowers_SnapshotThread(void *startParams) {
+	(void) startParams;
+	char path[PATH_MAX];
+	pthread_mutex_lock(&flowers_snapshotMutex);
+	for (;;) {
+		while (!GLOBALS.pending) {
+			pthread_cond_wait(&flowers_snapshotCond, &flowers_snapshotMutex);
+		}
+		void *data = GLOBALS.data;
+		size_t size = GLOBALS.size;
+		uint32_t version = GLOBALS.version;
+		memcpy(path, GLOBALS.path, sizeof path);
+		GLOBALS.data = NULL;
+		GLOBALS.pending = 0;
+		GLOBALS.writing = 1;
+		pthread_mutex_unlock(&flowers_snapshotMutex);
+
+		if (flowers_SnapshotWrite(path, version, data, size) != 0) {
+			LOGW("flowers_SnapshotThread", "failed to write %s", path);
+		}
+		free(data);
+
+		pthread_mutex_lock(&flowers_snapshotMutex);
+		GLOBALS.writing = 0;
+		pthread_cond_broadcast(&flowers_snapshotCond);
+	}
+	return NULL;
+}
+
+int flowers_SnapshotWriteAsync(const char *path, uint32_t version,
+		const void *data, size_t size) {
+	if (strlen(path) >= PATH_MAX) {
+		return -1;
+	}
+	void *copy = malloc(size);
+	if (copy == NULL) {
+		return -1;
+	}
+	memcpy(copy, data, size);
+
+	pthread_mutex_lock(&flowers_snapshotMutex);
+	if (!GLOBALS.threadCreated) {
+		pthread_attr_t attr;
+		pthread_attr_init(&attr);
+		pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+		GLOBALS.threadCreated = pthread_create(&GLOBALS.thread, &attr,
+				flowers_SnapshotThread, NULL) == 0;
+		pthread_attr_destroy(&attr);
+		if (!GLOBALS.threadCreated) {
+			pthread_mutex_unlock(&flowers_snapshotMutex);
+			free(copy);
+			return -1;
+		}
+	}
+	// Newer snapshot replaces one which hasn't been started yet.
+	free(GLOBALS.data);
+	strcpy(GLOBALS.path, path);
+	GLOBALS.version = version;
+	GLOBALS.data = copy;
+	GLOBALS.size = size;
+	GLOBALS.pending = 1;
+	pthread_cond_broadcast(&flowers_snapshotCond);
+	pthread_mutex_unlock(&flowers_snapshotMutex);
+	return 0;
+}
+
+void flowers_SnapshotWait() {
+	pthread_mutex_lock(&flowers_snapshotMutex);
+	while (GLOBALS.pending || GLOBALS.writing) {
+		pthread_cond_wait(&flowers_snapshotCond, &flowers_snapshotMutex);
+	}
+	pthread_mutex_unlock(&flowers_snapshotMutex);
+}
+
+const void* flowers_SnapshotMap(const char *path, uint32_t version,
+		size_t size) {
+	int fd = open(path, O_RDONLY);
+	if (fd < 0) {
+		return NULL;
+	}
+	struct stat st;
+	size_t fileSize = sizeof(flowers_snapshot_header_t) + size;
+	if (fstat(fd, &st) != 0 || st.st_size != (off_t) fileSize) {
+		close(fd);
+		return NULL;
+	}
+	void *map = mmap(NULL, fileSize, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (map == MAP_FAILED) {
+		return NULL;
+	}
+
+	const flowers_snapshot_header_t *header = map;
+	if (header->magic != FLOWERS_SNAPSHOT_MAGIC || header->version != version
+			|| header->size != size) {
+		munmap(map, fileSize);
+		return NULL;
+	}
+	return header + 1;
+}
+
+void flowers_SnapshotUnmap(const void *data, size_t size) {
+	if (data) {
+		const flowers_snapshot_header_t *header = data;
+		munmap((void*) (header - 1),
+				sizeof(flowers_snapshot_header_t) + size);
+	}
+}
@@ -0,0 +1,72 @@
+/*
+ Copyright 2012 Harri Smtt
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+ */
+
+
+#ifndef FLOWERS_SNAPSHOT_H__
+#define FLOWERS_SNAPSHOT_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ Snapshot file starts with this header, data follows right after it. Header
+ size keeps data 8 byte aligned within page aligned mapping so it can be
+ used in place.
+ */
+typedef struct {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t size;
+	uint32_t reserved;
+} flowers_snapshot_header_t;
+
+#define FLOWERS_SNAPSHOT_MAGIC 0x504e5346
+
+/*
+ Writes data into snapshot file. Data goes into temporary file first
+ which is synced and then renamed over given path, reader never sees
+ partially written snapshot. Returns zero on success.
+ */
+int flowers_SnapshotWrite(const char *path, uint32_t version,
+		const void *data, size_t size);
+
+/*
+ Copies data and returns right away, flowers_SnapshotWrite is called
+ for it on a background thread. Request still waiting to be written is
+ replaced by newer one. Returns zero if snapshot was queued.
+ */
+int flowers_SnapshotWriteAsync(const char *path, uint32_t version,
+		const void *data, size_t size);
+
+/*
+ Waits until all queued snapshots have been written.
+ */
+void flowers_SnapshotWait();
+
+/*
+ Maps snapshot file read-only. Returns pointer to data or NULL if file
+ doesn't exist or its version or size don't match with given ones.
+ Returned pointer has to be released with flowers_SnapshotUnmap.
+ */
+const void* flowers_SnapshotMap(const char *path, uint32_t version,
+		size_t size);
+
+/*
+ Unmaps data returned by flowers_SnapshotMap.
+ */
+void flowers_SnapshotUnmap(const void *data, size_t size);
+
+#endif
@@ -0,0 +1,674 @@
+/*
+ Copyright 2012 Harri Smtt
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+ */
+
+#ifdef GL_CAPTURE
+
+#define GL_CAPTURE_IMPL
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "gl_capture.h"
+#include "log.h"
+
+// Maximum number of vertex attributes tracked for client side arrays.
+#define GL_CAPTURE_ATTRIB_MAX 16
+// Maximum number of element array buffers shadowed at a time.
+#define GL_CAPTURE_SHADOW_MAX 8
+
+// Client side vertex attribute pointer which has to be
+// written into stream once draw call reveals its size.
+typedef struct {
+	GLboolean enabled;
+	GLboolean client;
+	GLint size;
+	GLenum type;
+	GLboolean normalized;
+	GLsizei stride;
+	const GLvoid *ptr;
+} gl_capture_attrib_t;
+
+// Copy of element array buffer contents. Needed for finding out how
+// many vertices client side arrays have to cover when indices are
+// read from buffer object.
+typedef struct {
+	GLuint buffer;
+	GLsizeiptr size;
+	GLubyte *data;
+} gl_capture_shadow_t;
+
+// Global capture state.
+#define GLOBALS gl_capture_globals
+typedef struct {
+	FILE *file;
+	GLboolean done;
+	int frameCount;
+	GLuint arrayBuffer;
+	GLuint elementArrayBuffer;
+	GLint unpackAlignment;
+	gl_capture_attrib_t attribs[GL_CAPTURE_ATTRIB_MAX];
+	gl_capture_shadow_t shadows[GL_CAPTURE_SHADOW_MAX];
+} gl_capture_globals_t;
+gl_capture_globals_t GLOBALS;
+
+// Writes opcode byte.
+void gl_CaptureOp(gl_capture_op_t op) {
+	unsigned char value = op;
+	fwrite(&value, 1, 1, GLOBALS.file);
+}
+
+// Writes one 32 bit word.
+void gl_CaptureWord(GLuint value) {
+	fwrite(&value, sizeof value, 1, GLOBALS.file);
+}
+
+// Writes one float word.
+void gl_CaptureFloat(GLfloat value) {
+	fwrite(&value, sizeof value, 1, GLOBALS.file);
+}
+
+// Writes length prefixed data blob.
+void gl_CaptureBlob(const GLvoid *data, GLuint size) {
+	gl_CaptureWord(size);
+	if (size > 0) {
+		fwrite(data, 1, size, GLOBALS.file);
+	}
+}
+
+// Writes command with given number of word arguments.
+void gl_CaptureCommand(gl_capture_op_t op, int count, GLuint a0, GLuint a1,
+		GLuint a2, GLuint a3) {
+	if (GLOBALS.file == NULL) {
+		return;
+	}
+	GLuint args[4] = { a0, a1, a2, a3 };
+	gl_CaptureOp(op);
+	fwrite(args, sizeof(GLuint), count, GLOBALS.file);
+}
+
+// Returns size of one component of given type in bytes.
+GLuint gl_CaptureTypeSize(GLenum type) {
+	switch (type) {
+	case GL_BYTE:
+	case GL_UNSIGNED_BYTE:
+		return 1;
+	case GL_SHORT:
+	case GL_UNSIGNED_SHORT:
+		return 2;
+	default:
+		return 4;
+	}
+}
+
+// Returns size of pixel data passed to glTexImage2D.
+GLuint gl_CapturePixelsSize(GLsizei width, GLsizei height, GLenum format,
+		GLenum type) {
+	GLuint bpp;
+	if (type == GL_UNSIGNED_SHORT_5_6_5 || type == GL_UNSIGNED_SHORT_4_4_4_4
+			|| type == GL_UNSIGNED_SHORT_5_5_5_1) {
+		bpp = 2;
+	} else if (format == GL_RGBA) {
+		bpp = 4;
+	} else if (format == GL_RGB) {
+		bpp = 3;
+	} else if (format == GL_LUMINANCE_ALPHA) {
+		bpp = 2;
+	} else {
+		bpp = 1;
+	}
+	GLuint align = GLOBALS.unpackAlignment;
+	GLuint row = (width * bpp + align - 1) / align * align;
+	return height > 0 ? row * (height - 1) + width * bpp : 0;
+}
+
+// Writes client side vertex data needed for drawing vertices up to count.
+void gl_CaptureClientAttribs(GLuint vertexCount) {
+	int idx;
+	for (idx = 0; idx < GL_CAPTURE_ATTRIB_MAX; ++idx) {
+		gl_capture_attrib_t *attrib = &GLOBALS.attribs[idx];
+		if (!attrib->enabled || !attrib->client || vertexCount == 0) {
+			continue;
+		}
+		GLuint elemSize = attrib->size * gl_CaptureTypeSize(attrib->type);
+		GLuint stride = attrib->stride ? (GLuint) attrib->stride : elemSize;
+		gl_CaptureOp(GL_CAPTURE_OP_ATTRIB_DATA);
+		gl_CaptureWord(idx);
+		gl_CaptureWord(attrib->size);
+		gl_CaptureWord(attrib->type);
+		gl_CaptureWord(attrib->normalized);
+		gl_CaptureWord(attrib->stride);
+		gl_CaptureBlob(attrib->ptr, stride * (vertexCount - 1) + elemSize);
+	}
+}
+
+// Returns shadow copy of given element array buffer, or allocates
+// a new one if create is set. Returns NULL if none is found.
+gl_capture_shadow_t* gl_CaptureShadow(GLuint buffer, GLboolean create) {
+	gl_capture_shadow_t *empty = NULL;
+	int idx;
+	for (idx = 0; idx < GL_CAPTURE_SHADOW_MAX; ++idx) {
+		gl_capture_shadow_t *shadow = &GLOBALS.shadows[idx];
+		if (shadow->buffer == buffer) {
+			return shadow;
+		}
+		if (shadow->buffer == 0 && empty == NULL) {
+			empty = shadow;
+		}
+	}
+	if (create && empty) {
+		empty->buffer = buffer;
+		empty->size = 0;
+		empty->data = NULL;
+		return empty;
+	}
+	return NULL;
+}
+
+// Releases shadow copy of given element array buffer.
+void gl_CaptureShadowRelease(GLuint buffer) {
+	gl_capture_shadow_t *shadow = gl_CaptureShadow(buffer, GL_FALSE);
+	if (shadow) {
+		free(shadow->data);
+		memset(shadow, 0, sizeof *shadow);
+	}
+}
+
+// Returns whether any enabled vertex attribute reads client side data.
+GLboolean gl_CaptureHasClientAttribs() {
+	int idx;
+	for (idx = 0; idx < GL_CAPTURE_ATTRIB_MAX; ++idx) {
+		if (GLOBALS.attribs[idx].enabled && GLOBALS.attribs[idx].client) {
+			return GL_TRUE;
+		}
+	}
+	return GL_FALSE;
+}
+
+// Returns number of vertices referenced by given indices.
+GLuint gl_CaptureVertexCount(const GLvoid *indices, GLsizei count,
+		GLuint indexSize) {
+	GLuint maxIndex = 0;
+	GLsizei idx;
+	for (idx = 0; idx < count; ++idx) {
+		GLuint value = indexSize == 1 ?
+				((const GLubyte*) indices)[idx] :
+				((const GLushort*) indices)[idx];
+		maxIndex = value > maxIndex ? value : maxIndex;
+	}
+	return count > 0 ? maxIndex + 1 : 0;
+}
+
+void gl_CaptureStart(const char *path) {
+	// Buffer bindings and attribute state belong to previous context,
+	// if any, and are gone along with it.
+	int idx;
+	GLOBALS.arrayBuffer = 0;
+	GLOBALS.elementArrayBuffer = 0;
+	memset(GLOBALS.attribs, 0, sizeof GLOBALS.attribs);
+	for (idx = 0; idx < GL_CAPTURE_SHADOW_MAX; ++idx) {
+		free(GLOBALS.shadows[idx].data);
+	}
+	memset(GLOBALS.shadows, 0, sizeof GLOBALS.shadows);
+
+	if (GLOBALS.file || GLOBALS.done) {
+		return;
+	}
+	GLOBALS.file = fopen(path, "wb");
+	if (GLOBALS.file == NULL) {
+		LOGE("gl_CaptureStart", "fopen %s failed", path);
+		return;
+	}
+	LOGD("gl_CaptureStart", "recording to %s", path);
+	GLOBALS.frameCount = 0;
+	GLOBALS.unpackAlignment = 4;
+	gl_CaptureWord(GL_CAPTURE_MAGIC);
+	gl_CaptureWord(GL_CAPTURE_VERSION);
+}
+
+void gl_CaptureStop() {
+	if (GLOBALS.file) {
+		fclose(GLOBALS.file);
+		GLOBALS.file = NULL;
+		GLOBALS.done = GL_TRUE;
+		LOGD("gl_CaptureStop", "frames=%d", GLOBALS.frameCount);
+	}
+}
+
+void gl_CaptureFrameEnd() {
+	if (GLOBALS.file) {
+		gl_CaptureCommand(GL_CAPTURE_OP_FRAME_END, 0, 0, 0, 0, 0);
+		if (++GLOBALS.frameCount >= GL_CAPTURE_FRAMES) {
+			gl_CaptureStop();
+		}
+	}
+}
+
+void gl_CaptureViewport(GLint x, GLint y, GLsizei width, GLsizei height) {
+	gl_CaptureCommand(GL_CAPTURE_OP_VIEWPORT, 4, x, y, width, height);
+	glViewport(x, y, width, height);
+}
+
+void gl_CaptureClear(GLbitfield mask) {
+	gl_CaptureCommand(GL_CAPTURE_OP_CLEAR, 1, mask, 0, 0, 0);
+	glClear(mask);
+}
+
+void gl_CaptureClearColor(GLclampf r, GLclampf g, GLclampf b, GLclampf a) {
+	if (GLOBALS.file) {
+		gl_CaptureOp(GL_CAPTURE_OP_CLEAR_COLOR);
+		gl_CaptureFloat(r);
+		gl_CaptureFloat(g);
+		gl_CaptureFloat(b);
+		gl_CaptureFloat(a);
+	}
+	glClearColor(r, g, b, a);
+}
+
+void gl_CaptureEnable(GLenum cap) {
+	gl_CaptureCommand(GL_CAPTURE_OP_ENABLE, 1, cap, 0, 0, 0);
+	glEnable(cap);
+}
+
+void gl_CaptureDisable(GLenum cap) {
+	gl_CaptureCommand(GL_CAPTURE_OP_DISABLE, 1, cap, 0, 0, 0);
+	glDisable(cap);
+}
+
+void gl_CaptureBlendFunc(GLenum sfactor, GLenum dfactor) {
+	gl_CaptureCommand(GL_CAPTURE_OP_BLEND_FUNC, 2, sfactor, dfactor, 0, 0);
+	glBlendFunc(sfactor, dfactor);
+}
+
+void gl_CapturePixelStorei(GLenum pname, GLint param) {
+	if (pname == GL_UNPACK_ALIGNMENT) {
+		GLOBALS.unpackAlignment = param;
+	}
+	gl_CaptureCommand(GL_CAPTURE_OP_PIXEL_STOREI, 2, pname, param, 0, 0);
+	glPixelStorei(pname, param);
+}
+
+GLuint gl_CaptureCreateShader(GLenum type) {
+	GLuint shader = glCreateShader(type);
+	gl_CaptureCommand(GL_CAPTURE_OP_CREATE_SHADER, 2, type, shader, 0, 0);
+	return shader;
+}
+
+void gl_CaptureShaderSource(GLuint shader, GLsizei count,
+		const GLchar* const *string, const GLint *length) {
+	if (GLOBALS.file) {
+		// Concatenate all source strings into one.
+		GLuint size = 0;
+		GLsizei idx;
+		for (idx = 0; idx < count; ++idx) {
+			size += length && length[idx] >= 0 ?
+					(GLuint) length[idx] : strlen(string[idx]);
+		}
+		gl_CaptureOp(GL_CAPTURE_OP_SHADER_SOURCE);
+		gl_CaptureWord(shader);
+		gl_CaptureWord(size);
+		for (idx = 0; idx < count; ++idx) {
+			GLuint len = length && length[idx] >= 0 ?
+					(GLuint) length[idx] : strlen(string[idx]);
+			fwrite(string[idx], 1, len, GLOBALS.file);
+		}
+	}
+	glShaderSource(shader, count, string, length);
+}
+
+void gl_CaptureCompileShader(GLuint shader) {
+	gl_CaptureCommand(GL_CAPTURE_OP_COMPILE_SHADER, 1, shader, 0, 0, 0);
+	glCompileShader(shader);
+}
+
+void gl_CaptureDeleteShader(GLuint shader) {
+	gl_CaptureCommand(GL_CAPTURE_OP_DELETE_SHADER, 1, shader, 0, 0, 0);
+	glDeleteShader(shader);
+}
+
+GLuint gl_CaptureCreateProgram() {
+	GLuint program = glCreateProgram();
+	gl_CaptureCommand(GL_CAPTURE_OP_CREATE_PROGRAM, 1, program, 0, 0, 0);
+	return program;
+}
+
+void gl_CaptureAttachShader(GLuint program, GLuint shader) {
+	gl_CaptureCommand(GL_CAPTURE_OP_ATTACH_SHADER, 2, program, shader, 0, 0);
+	glAttachShader(program, shader);
+}
+
+void gl_CaptureLinkProgram(GLuint program) {
+	gl_CaptureCommand(GL_CAPTURE_OP_LINK_PROGRAM, 1, program, 0, 0, 0);
+	glLinkProgram(program);
+}
+
+void gl_CaptureDeleteProgram(GLuint program) {
+	gl_CaptureCommand(GL_CAPTURE_OP_DELETE_PROGRAM, 1, program, 0, 0, 0);
+	glDeleteProgram(program);
+}
+
+void gl_CaptureUseProgram(GLuint program) {
+	gl_CaptureCommand(GL_CAPTURE_OP_USE_PROGRAM, 1, program, 0, 0, 0);
+	glUseProgram(program);
+}
+
+GLint gl_CaptureGetUniformLocation(GLuint program, const GLchar *name) {
+	GLint location = glGetUniformLocation(program, name);
+	if (GLOBALS.file) {
+		gl_CaptureOp(GL_CAPTURE_OP_GET_UNIFORM_LOCATION);
+		gl_CaptureWord(program);
+		gl_CaptureWord(location);
+		gl_CaptureBlob(name, strlen(name));
+	}
+	return location;
+}
+
+GLint gl_CaptureGetAttribLocation(GLuint program, const GLchar *name) {
+	GLint location = glGetAttribLocation(program, name);
+	if (GLOBALS.file) {
+		gl_CaptureOp(GL_CAPTURE_OP_GET_ATTRIB_LOCATION);
+		gl_CaptureWord(program);
+		gl_CaptureWord(location);
+		gl_CaptureBlob(name, strlen(name));
+	}
+	return location;
+}
+
+void gl_CaptureUniform1i(GLint location, GLint x) {
+	gl_CaptureCommand(GL_CAPTURE_OP_UNIFORM1I, 2, location, x, 0, 0);
+	glUniform1i(location, x);
+}
+
+void gl_CaptureUniform1f(GLint location, GLfloat x) {
+	if (GLOBALS.file) {
+		gl_CaptureOp(GL_CAPTURE_OP_UNIFORM1F);
+		gl_CaptureWord(location);
+		gl_CaptureFloat(x);
+	}
+	glUniform1f(location, x);
+}
+
+void gl_CaptureUniform2f(GLint location, GLfloat x, GLfloat y) {
+	if (GLOBALS.file) {
+		gl_CaptureOp(GL_CAPTURE_OP_UNIFORM2F);
+		gl_CaptureWord(location);
+		gl_CaptureFloat(x);
+		gl_CaptureFloat(y);
+	}
+	glUniform2f(location, x, y);
+}
+
+void gl_CaptureUniform4f(GLint location, GLfloat x, GLfloat y, GLfloat z,
+		GLfloat w) {
+	if (GLOBALS.file) {
+		gl_CaptureOp(GL_CAPTURE_OP_UNIFORM4F);
+		gl_CaptureWord(location);
+		gl_CaptureFloat(x);
+		gl_CaptureFloat(y);
+		gl_CaptureFloat(z);
+		gl_CaptureFloat(w);
+	}
+	glUniform4f(location, x, y, z, w);
+}
+
+void gl_CaptureEnableVertexAttribArray(GLuint index) {
+	if (index < GL_CAPTURE_ATTRIB_MAX) {
+		GLOBALS.attribs[index].enabled = GL_TRUE;
+	}
+	gl_CaptureCommand(GL_CAPTURE_OP_ENABLE_ATTRIB, 1, index, 0, 0, 0);
+	glEnableVertexAttribArray(index);
+}
+
+void gl_CaptureDisableVertexAttribArray(GLuint index) {
+	if (index < GL_CAPTURE_ATTRIB_MAX) {
+		GLOBALS.attribs[index].enabled = GL_FALSE;
+	}
+	gl_CaptureCommand(GL_CAPTURE_OP_DISABLE_ATTRIB, 1, index, 0, 0, 0);
+	glDisableVertexAttribArray(index);
+}
+
+void gl_CaptureVertexAttribPointer(GLuint index, GLint size, GLenum type,
+		GLboolean normalized, GLsizei stride, const GLvoid *ptr) {
+	if (index < GL_CAPTURE_ATTRIB_MAX) {
+		gl_capture_attrib_t *attrib = &GLOBALS.attribs[index];
+		attrib->client = GLOBALS.arrayBuffer == 0;
+		attrib->size = size;
+		attrib->type = type;
+		attrib->normalized = normalized;
+		attrib->stride = stride;
+		attrib->ptr = ptr;
+		// Pointers into buffer objects are offsets and can be
+		// written right away. Client side data is written on draw.
+		if (!attrib->client && GLOBALS.file) {
+			gl_CaptureOp(GL_CAPTURE_OP_ATTRIB_POINTER);
+			gl_CaptureWord(index);
+			gl_CaptureWord(size);
+			gl_CaptureWord(type);
+			gl_CaptureWord(normalized);
+			gl_CaptureWord(stride);
+			gl_CaptureWord((GLuint) (size_t) ptr);
+		}
+	}
+	glVertexAttribPointer(index, size, type, normalized, stride, ptr);
+}
+
+void gl_CaptureDrawArrays(GLenum mode, GLint first, GLsizei count) {
+	if (GLOBALS.file) {
+		gl_CaptureClientAttribs(first + count);
+		gl_CaptureCommand(GL_CAPTURE_OP_DRAW_ARRAYS, 3, mode, first, count, 0);
+	}
+	glDrawArrays(mode, first, count);
+}
+
+void gl_CaptureDrawElements(GLenum mode, GLsizei count, GLenum type,
+		const GLvoid *indices) {
+	if (GLOBALS.file) {
+		GLuint indexSize = gl_CaptureTypeSize(type);
+		if (GLOBALS.elementArrayBuffer == 0) {
+			gl_CaptureClientAttribs(
+					gl_CaptureVertexCount(indices, count, indexSize));
+			gl_CaptureOp(GL_CAPTURE_OP_DRAW_ELEMENTS_DATA);
+			gl_CaptureWord(mode);
+			gl_CaptureWord(count);
+			gl_CaptureWord(type);
+			gl_CaptureBlob(indices, count * indexSize);
+		} else if (!gl_CaptureHasClientAttribs()) {
+			gl_CaptureCommand(GL_CAPTURE_OP_DRAW_ELEMENTS, 4, mode, count,
+					type, (GLuint) (size_t) indices);
+		} else {
+			// Index data lives in buffer object, use shadow copy for
+			// finding out how many vertices client arrays cover.
+			gl_capture_shadow_t *shadow = gl_CaptureShadow(
+					GLOBALS.elementArrayBuffer, GL_FALSE);
+			GLuint offset = (GLuint) (size_t) indices;
+			if (shadow == NULL || shadow->data == NULL
+					|| offset + count * indexSize > (GLuint) shadow->size) {
+				// Recording would not replay, better to end it here.
+				LOGE("gl_CaptureDrawElements",
+						"no index data for client arrays, buffer=%u",
+						GLOBALS.elementArrayBuffer);
+				gl_CaptureStop();
+			} else {
+				gl_CaptureClientAttribs(
+						gl_CaptureVertexCount(shadow->data + offset, count,
+								indexSize));
+				gl_CaptureCommand(GL_CAPTURE_OP_DRAW_ELEMENTS, 4, mode,
+						count, type, offset);
+			}
+		}
+	}
+	glDrawElements(mode, count, type, indices);
+}
+
+void gl_CaptureGenBuffers(GLsizei n, GLuint *buffers) {
+	glGenBuffers(n, buffers);
+	GLsizei idx;
+	for (idx = 0; idx < n; ++idx) {
+		gl_CaptureCommand(GL_CAPTURE_OP_GEN_BUFFER, 1, buffers[idx], 0, 0, 0);
+	}
+}
+
+void gl_CaptureDeleteBuffers(GLsizei n, const GLuint *buffers) {
+	GLsizei idx;
+	for (idx = 0; idx < n; ++idx) {
+		if (GLOBALS.arrayBuffer == buffers[idx]) {
+			GLOBALS.arrayBuffer = 0;
+		}
+		if (GLOBALS.elementArrayBuffer == buffers[idx]) {
+			GLOBALS.elementArrayBuffer = 0;
+		}
+		if (buffers[idx]) {
+			gl_CaptureShadowRelease(buffers[idx]);
+		}
+		gl_CaptureCommand(GL_CAPTURE_OP_DELETE_BUFFER, 1, buffers[idx], 0, 0,
+				0);
+	}
+	glDeleteBuffers(n, buffers);
+}
+
+void gl_CaptureBindBuffer(GLenum target, GLuint buffer) {
+	if (target == GL_ARRAY_BUFFER) {
+		GLOBALS.arrayBuffer = buffer;
+	} else {
+		GLOBALS.elementArrayBuffer = buffer;
+	}
+	gl_CaptureCommand(GL_CAPTURE_OP_BIND_BUFFER, 2, target, buffer, 0, 0);
+	glBindBuffer(target, buffer);
+}
+
+void gl_CaptureBufferData(GLenum target, GLsizeiptr size, const GLvoid *data,
+		GLenum usage) {
+	if (GLOBALS.file) {
+		gl_CaptureOp(GL_CAPTURE_OP_BUFFER_DATA);
+		gl_CaptureWord(target);
+		gl_CaptureWord(usage);
+		gl_CaptureWord(size);
+		gl_CaptureBlob(data, data ? size : 0);
+		// Keep copy of element array buffer contents.
+		if (target == GL_ELEMENT_ARRAY_BUFFER && GLOBALS.elementArrayBuffer) {
+			gl_capture_shadow_t *shadow = gl_CaptureShadow(
+					GLOBALS.elementArrayBuffer, GL_TRUE);
+			GLubyte *copy = shadow && size > 0 ?
+					realloc(shadow->data, size) : NULL;
+			if (copy) {
+				shadow->data = copy;
+				shadow->size = size;
+				if (data) {
+					memcpy(copy, data, size);
+				}
+			} else if (shadow && size == 0) {
+				free(shadow->data);
+				shadow->data = NULL;
+				shadow->size = 0;
+			} else {
+				LOGE("gl_CaptureBufferData", "shadow failed, buffer=%u",
+						GLOBALS.elementArrayBuffer);
+				gl_CaptureShadowRelease(GLOBALS.elementArrayBuffer);
+			}
+		}
+	}
+	glBufferData(target, size, data, usage);
+}
+
+void gl_CaptureBufferSubData(GLenum target, GLintptr offset, GLsizeiptr size,
+		const GLvoid *data) {
+	if (GLOBALS.file) {
+		gl_CaptureOp(GL_CAPTURE_OP_BUFFER_SUB_DATA);
+		gl_CaptureWord(target);
+		gl_CaptureWord(offset);
+		gl_CaptureBlob(data, size);
+		if (target == GL_ELEMENT_ARRAY_BUFFER && GLOBALS.elementArrayBuffer) {
+			gl_capture_shadow_t *shadow = gl_CaptureShadow(
+					GLOBALS.elementArrayBuffer, GL_FALSE);
+			if (shadow && shadow->data && offset + size <= shadow->size) {
+				memcpy(shadow->data + offset, data, size);
+			}
+		}
+	}
+	glBufferSubData(target, offset, size, data);
+}
+
+void gl_CaptureGenTextures(GLsizei n, GLuint *textures) {
+	glGenTextures(n, textures);
+	GLsizei idx;
+	for (idx = 0; idx < n; ++idx) {
+		gl_CaptureCommand(GL_CAPTURE_OP_GEN_TEXTURE, 1, textures[idx], 0, 0,
+				0);
+	}
+}
+
+void gl_CaptureDeleteTextures(GLsizei n, const GLuint *textures) {
+	GLsizei idx;
+	for (idx = 0; idx < n; ++idx) {
+		gl_CaptureCommand(GL_CAPTURE_OP_DELETE_TEXTURE, 1, textures[idx], 0, 0,
+				0);
+	}
+	glDeleteTextures(n, textures);
+}
+
+void gl_CaptureActiveTexture(GLenum texture) {
+	gl_CaptureCommand(GL_CAPTURE_OP_ACTIVE_TEXTURE, 1, texture, 0, 0, 0);
+	glActiveTexture(texture);
+}
+
+void gl_CaptureBindTexture(GLenum target, GLuint texture) {
+	gl_CaptureCommand(GL_CAPTURE_OP_BIND_TEXTURE, 2, target, texture, 0, 0);
+	glBindTexture(target, texture);
+}
+
+void gl_CaptureTexParameteri(GLenum target, GLenum pname, GLint param) {
+	gl_CaptureCommand(GL_CAPTURE_OP_TEX_PARAMETERI, 3, target, pname, param,
+			0);
+	glTexParameteri(target, pname, param);
+}
+
+void gl_CaptureTexImage2D(GLenum target, GLint level, GLint internalformat,
+		GLsizei width, GLsizei height, GLint border, GLenum format,
+		GLenum type, const GLvoid *pixels) {
+	if (GLOBALS.file) {
+		gl_CaptureOp(GL_CAPTURE_OP_TEX_IMAGE_2D);
+		gl_CaptureWord(target);
+		gl_CaptureWord(level);
+		gl_CaptureWord(internalformat);
+		gl_CaptureWord(width);
+		gl_CaptureWord(height);
+		gl_CaptureWord(format);
+		gl_CaptureWord(type);
+		gl_CaptureBlob(pixels,
+				pixels ? gl_CapturePixelsSize(width, height, format, type) : 0);
+	}
+	glTexImage2D(target, level, internalformat, width, height, border, format,
+			type, pixels);
+}
+
+void gl_CaptureTexSubImage2D(GLenum target, GLint level, GLint xoffset,
+		GLint yoffset, GLsizei width, GLsizei height, GLenum format,
+		GLenum type, const GLvoid *pixels) {
+	if (GLOBALS.file) {
+		gl_CaptureOp(GL_CAPTURE_OP_TEX_SUB_IMAGE_2D);
+		gl_CaptureWord(target);
+		gl_CaptureWord(level);
+		gl_CaptureWord(xoffset);
+		gl_CaptureWord(yoffset);
+		gl_CaptureWord(width);
+		gl_CaptureWord(height);
+		gl_CaptureWord(format);
+		gl_CaptureWord(type);
+		gl_CaptureBlob(pixels, gl_CapturePixelsSize(width, height, format, type));
+	}
+	glTexSubImage2D(target, level, xoffset, yoffset, width, height, format,
+			type, pixels);
+}
+
+#endif
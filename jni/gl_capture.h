@@ -0,0 +1,212 @@
+/*
+ Copyright 2012 Harri Smtt
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+ */
+
+#ifndef GL_CAPTURE_H__
+#define GL_CAPTURE_H__
+
+#include <GLES2/gl2.h>
+
+/*
+ GL command stream format shared by capture layer and tools/gl_replay.c.
+
+ Stream starts with magic and version words followed by commands. Each
+ command is one opcode byte followed by its arguments, all of them 32 bit
+ little endian words. Variable length data (shader sources, uniform names,
+ buffer, texture and client side vertex data) is stored as a length word
+ followed by raw bytes. Object names and locations are stored as they were
+ returned on device and are remapped by the replayer.
+ */
+#define GL_CAPTURE_MAGIC    0x50434c47
+#define GL_CAPTURE_VERSION  1
+
+typedef enum {
+	GL_CAPTURE_OP_FRAME_END = 1,
+	GL_CAPTURE_OP_VIEWPORT,
+	GL_CAPTURE_OP_CLEAR,
+	GL_CAPTURE_OP_CLEAR_COLOR,
+	GL_CAPTURE_OP_ENABLE,
+	GL_CAPTURE_OP_DISABLE,
+	GL_CAPTURE_OP_BLEND_FUNC,
+	GL_CAPTURE_OP_PIXEL_STOREI,
+	GL_CAPTURE_OP_CREATE_SHADER,
+	GL_CAPTURE_OP_SHADER_SOURCE,
+	GL_CAPTURE_OP_COMPILE_SHADER,
+	GL_CAPTURE_OP_DELETE_SHADER,
+	GL_CAPTURE_OP_CREATE_PROGRAM,
+	GL_CAPTURE_OP_ATTACH_SHADER,
+	GL_CAPTURE_OP_LINK_PROGRAM,
+	GL_CAPTURE_OP_DELETE_PROGRAM,
+	GL_CAPTURE_OP_USE_PROGRAM,
+	GL_CAPTURE_OP_GET_UNIFORM_LOCATION,
+	GL_CAPTURE_OP_GET_ATTRIB_LOCATION,
+	GL_CAPTURE_OP_UNIFORM1I,
+	GL_CAPTURE_OP_UNIFORM1F,
+	GL_CAPTURE_OP_UNIFORM2F,
+	GL_CAPTURE_OP_UNIFORM4F,
+	GL_CAPTURE_OP_ENABLE_ATTRIB,
+	GL_CAPTURE_OP_DISABLE_ATTRIB,
+	GL_CAPTURE_OP_ATTRIB_POINTER,
+	GL_CAPTURE_OP_ATTRIB_DATA,
+	GL_CAPTURE_OP_DRAW_ARRAYS,
+	GL_CAPTURE_OP_DRAW_ELEMENTS,
+	GL_CAPTURE_OP_DRAW_ELEMENTS_DATA,
+	GL_CAPTURE_OP_GEN_BUFFER,
+	GL_CAPTURE_OP_DELETE_BUFFER,
+	GL_CAPTURE_OP_BIND_BUFFER,
+	GL_CAPTURE_OP_BUFFER_DATA,
+	GL_CAPTURE_OP_BUFFER_SUB_DATA,
+	GL_CAPTURE_OP_GEN_TEXTURE,
+	GL_CAPTURE_OP_DELETE_TEXTURE,
+	GL_CAPTURE_OP_ACTIVE_TEXTURE,
+	GL_CAPTURE_OP_BIND_TEXTURE,
+	GL_CAPTURE_OP_TEX_PARAMETERI,
+	GL_CAPTURE_OP_TEX_IMAGE_2D,
+	GL_CAPTURE_OP_TEX_SUB_IMAGE_2D,
+	GL_CAPTURE_OP_COUNT
+} gl_capture_op_t;
+
+// Default location and length of a capture. Application has write
+// access to its own data directory, use "adb shell run-as" to pull it.
+#ifndef GL_CAPTURE_PATH
+#define GL_CAPTURE_PATH "/data/data/fi.harism.wallpaper.flowersndk/capture.glcap"
+#endif
+#ifndef GL_CAPTURE_FRAMES
+#define GL_CAPTURE_FRAMES 300
+#endif
+
+#ifdef GL_CAPTURE
+
+/*
+ Starts recording into given file. Does nothing if recording is
+ already active or a capture has been completed. Has to be called for
+ every new context as it resets tracked buffer and attribute state.
+ */
+void gl_CaptureStart(const char *path);
+
+/*
+ Stops recording and closes capture file.
+ */
+void gl_CaptureStop();
+
+/*
+ Marks end of frame. Recording stops automatically once
+ GL_CAPTURE_FRAMES frames have been written.
+ */
+void gl_CaptureFrameEnd();
+
+void gl_CaptureViewport(GLint x, GLint y, GLsizei width, GLsizei height);
+void gl_CaptureClear(GLbitfield mask);
+void gl_CaptureClearColor(GLclampf r, GLclampf g, GLclampf b, GLclampf a);
+void gl_CaptureEnable(GLenum cap);
+void gl_CaptureDisable(GLenum cap);
+void gl_CaptureBlendFunc(GLenum sfactor, GLenum dfactor);
+void gl_CapturePixelStorei(GLenum pname, GLint param);
+GLuint gl_CaptureCreateShader(GLenum type);
+void gl_CaptureShaderSource(GLuint shader, GLsizei count,
+		const GLchar* const *string, const GLint *length);
+void gl_CaptureCompileShader(GLuint shader);
+void gl_CaptureDeleteShader(GLuint shader);
+GLuint gl_CaptureCreateProgram();
+void gl_CaptureAttachShader(GLuint program, GLuint shader);
+void gl_CaptureLinkProgram(GLuint program);
+void gl_CaptureDeleteProgram(GLuint program);
+void gl_CaptureUseProgram(GLuint program);
+GLint gl_CaptureGetUniformLocation(GLuint program, const GLchar *name);
+GLint gl_CaptureGetAttribLocation(GLuint program, const GLchar *name);
+void gl_CaptureUniform1i(GLint location, GLint x);
+void gl_CaptureUniform1f(GLint location, GLfloat x);
+void gl_CaptureUniform2f(GLint location, GLfloat x, GLfloat y);
+void gl_CaptureUniform4f(GLint location, GLfloat x, GLfloat y, GLfloat z,
+		GLfloat w);
+void gl_CaptureEnableVertexAttribArray(GLuint index);
+void gl_CaptureDisableVertexAttribArray(GLuint index);
+void gl_CaptureVertexAttribPointer(GLuint index, GLint size, GLenum type,
+		GLboolean normalized, GLsizei stride, const GLvoid *ptr);
+void gl_CaptureDrawArrays(GLenum mode, GLint first, GLsizei count);
+void gl_CaptureDrawElements(GLenum mode, GLsizei count, GLenum type,
+		const GLvoid *indices);
+void gl_CaptureGenBuffers(GLsizei n, GLuint *buffers);
+void gl_CaptureDeleteBuffers(GLsizei n, const GLuint *buffers);
+void gl_CaptureBindBuffer(GLenum target, GLuint buffer);
+void gl_CaptureBufferData(GLenum target, GLsizeiptr size, const GLvoid *data,
+		GLenum usage);
+void gl_CaptureBufferSubData(GLenum target, GLintptr offset, GLsizeiptr size,
+		const GLvoid *data);
+void gl_CaptureGenTextures(GLsizei n, GLuint *textures);
+void gl_CaptureDeleteTextures(GLsizei n, const GLuint *textures);
+void gl_CaptureActiveTexture(GLenum texture);
+void gl_CaptureBindTexture(GLenum target, GLuint texture);
+void gl_CaptureTexParameteri(GLenum target, GLenum pname, GLint param);
+void gl_CaptureTexImage2D(GLenum target, GLint level, GLint internalformat,
+		GLsizei width, GLsizei height, GLint border, GLenum format,
+		GLenum type, const GLvoid *pixels);
+void gl_CaptureTexSubImage2D(GLenum target, GLint level, GLint xoffset,
+		GLint yoffset, GLsizei width, GLsizei height, GLenum format,
+		GLenum type, const GLvoid *pixels);
+
+// Redirect GL calls into capture layer in every file including
+// this header, except for capture implementation itself.
+#ifndef GL_CAPTURE_IMPL
+#define glViewport gl_CaptureViewport
+#define glClear gl_CaptureClear
+#define glClearColor gl_CaptureClearColor
+#define glEnable gl_CaptureEnable
+#define glDisable gl_CaptureDisable
+#define glBlendFunc gl_CaptureBlendFunc
+#define glPixelStorei gl_CapturePixelStorei
+#define glCreateShader gl_CaptureCreateShader
+#define glShaderSource gl_CaptureShaderSource
+#define glCompileShader gl_CaptureCompileShader
+#define glDeleteShader gl_CaptureDeleteShader
+#define glCreateProgram gl_CaptureCreateProgram
+#define glAttachShader gl_CaptureAttachShader
+#define glLinkProgram gl_CaptureLinkProgram
+#define glDeleteProgram gl_CaptureDeleteProgram
+#define glUseProgram gl_CaptureUseProgram
+#define glGetUniformLocation gl_CaptureGetUniformLocation
+#define glGetAttribLocation gl_CaptureGetAttribLocation
+#define glUniform1i gl_CaptureUniform1i
+#define glUniform1f gl_CaptureUniform1f
+#define glUniform2f gl_CaptureUniform2f
+#define glUniform4f gl_CaptureUniform4f
+#define glEnableVertexAttribArray gl_CaptureEnableVertexAttribArray
+#define glDisableVertexAttribArray gl_CaptureDisableVertexAttribArray
+#define glVertexAttribPointer gl_CaptureVertexAttribPointer
+#define glDrawArrays gl_CaptureDrawArrays
+#define glDrawElements gl_CaptureDrawElements
+#define glGenBuffers gl_CaptureGenBuffers
+#define glDeleteBuffers gl_CaptureDeleteBuffers
+#define glBindBuffer gl_CaptureBindBuffer
+#define glBufferData gl_CaptureBufferData
+#define glBufferSubData gl_CaptureBufferSubData
+#define glGenTextures gl_CaptureGenTextures
+#define glDeleteTextures gl_CaptureDeleteTextures
+#define glActiveTexture gl_CaptureActiveTexture
+#define glBindTexture gl_CaptureBindTexture
+#define glTexParameteri gl_CaptureTexParameteri
+#define glTexImage2D gl_CaptureTexImage2D
+#define glTexSubImage2D gl_CaptureTexSubImage2D
+#endif
+
+#else
+
+#define gl_CaptureStart(path)
+#define gl_CaptureStop()
+#define gl_CaptureFrameEnd()
+
+#endif
+
+#endif
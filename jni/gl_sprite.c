@@ -0,0 +1,178 @@
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "gl_sprite.h"
+#include "gl_utils.h"
+#include "gl_capture.h"
+
+// Empty pixels left between packed images to prevent filtering
+// from bleeding neighbouring images in.
+#define GL_SPRITE_PADDING 1
+
+void gl_SpriteAtlasCreate(gl_sprite_atlas_t *atlas, GLint width, GLint height) {
+	memset(atlas, 0, sizeof *atlas);
+	atlas->width = width;
+	atlas->height = height;
+	atlas->pixels = calloc(width * height, 1);
+}
+
+GLboolean gl_SpriteAtlasAdd(gl_sprite_atlas_t *atlas, GLint width,
+		GLint height, const GLubyte *pixels, gl_sprite_region_t *region) {
+	if (atlas->pixels == NULL) {
+		return GL_FALSE;
+	}
+	// If image doesn't fit on current row start a new one.
+	if (atlas->rowX + width > atlas->width) {
+		atlas->rowX = 0;
+		atlas->rowY += atlas->rowHeight + GL_SPRITE_PADDING;
+		atlas->rowHeight = 0;
+	}
+	if (width > atlas->width || atlas->rowY + height > atlas->height) {
+		return GL_FALSE;
+	}
+	GLint y;
+	for (y = 0; y < height; ++y) {
+		memcpy(&atlas->pixels[(atlas->rowY + y) * atlas->width + atlas->rowX],
+				&pixels[y * width], width);
+	}
+	region->u0 = (GLfloat) atlas->rowX / atlas->width;
+	region->v0 = (GLfloat) atlas->rowY / atlas->height;
+	region->u1 = (GLfloat) (atlas->rowX + width) / atlas->width;
+	region->v1 = (GLfloat) (atlas->rowY + height) / atlas->height;
+	atlas->rowX += width + GL_SPRITE_PADDING;
+	if (height > atlas->rowHeight) {
+		atlas->rowHeight = height;
+	}
+	return GL_TRUE;
+}
+
+void gl_SpriteAtlasUpload(gl_sprite_atlas_t *atlas) {
+	if (atlas->pixels == NULL) {
+		return;
+	}
+	glGenTextures(1, &atlas->texture);
+	gl_StateActiveTexture(GL_TEXTURE0);
+	gl_StateBindTexture(atlas->texture);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_LUMINANCE, atlas->width, atlas->height,
+			0, GL_LUMINANCE, GL_UNSIGNED_BYTE, atlas->pixels);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	free(atlas->pixels);
+	atlas->pixels = NULL;
+}
+
+void gl_SpriteAtlasRelease(gl_sprite_atlas_t *atlas) {
+	gl_StateForgetTexture(atlas->texture);
+	glDeleteTextures(1, &atlas->texture);
+	free(atlas->pixels);
+	memset(atlas, 0, sizeof *atlas);
+}
+
+void gl_SpriteVertexFormat(gl_vertex_format_t *format) {
+	const GLfloat positionScale[] = { GL_SPRITE_RANGE, GL_SPRITE_RANGE };
+	gl_VertexFormatInit(format, sizeof(gl_sprite_vertex_t));
+	gl_VertexFormatAdd(format, "aPosition", 2, GL_SHORT, GL_TRUE,
+			offsetof(gl_sprite_vertex_t, x), positionScale, NULL);
+	gl_VertexFormatAdd(format, "aTextureCoord", 2, GL_UNSIGNED_SHORT, GL_TRUE,
+			offsetof(gl_sprite_vertex_t, u), NULL, NULL);
+	gl_VertexFormatAdd(format, "aColor", 4, GL_UNSIGNED_BYTE, GL_TRUE,
+			offsetof(gl_sprite_vertex_t, r), NULL, NULL);
+}
+
+void gl_SpriteBatchCreate(gl_sprite_batch_t *batch) {
+	memset(batch, 0, sizeof *batch);
+
+	// Index buffer never changes, two triangles per sprite.
+	GLushort indices[GL_SPRITE_MAX * 6];
+	GLushort idx;
+	for (idx = 0; idx < GL_SPRITE_MAX; ++idx) {
+		GLushort *quad = &indices[idx * 6];
+		quad[0] = idx * 4;
+		quad[1] = idx * 4 + 1;
+		quad[2] = idx * 4 + 2;
+		quad[3] = idx * 4;
+		quad[4] = idx * 4 + 2;
+		quad[5] = idx * 4 + 3;
+	}
+
+	GLuint buffers[2];
+	glGenBuffers(2, buffers);
+	batch->vertexBuffer = buffers[0];
+	batch->indexBuffer = buffers[1];
+	gl_StateBindBuffer(GL_ELEMENT_ARRAY_BUFFER, batch->indexBuffer);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof indices, indices,
+			GL_STATIC_DRAW);
+}
+
+void gl_SpriteBatchRelease(gl_sprite_batch_t *batch) {
+	GLuint buffers[2] = { batch->vertexBuffer, batch->indexBuffer };
+	gl_StateForgetBuffer(batch->vertexBuffer);
+	gl_StateForgetBuffer(batch->indexBuffer);
+	glDeleteBuffers(2, buffers);
+	memset(batch, 0, sizeof *batch);
+}
+
+void gl_SpriteBatchBegin(gl_sprite_batch_t *batch,
+		gl_sprite_stats_t *lastFrame) {
+	if (lastFrame) {
+		*lastFrame = batch->stats;
+	}
+	memset(&batch->stats, 0, sizeof batch->stats);
+	batch->count = 0;
+}
+
+void gl_SpriteBatchAdd(gl_sprite_batch_t *batch,
+		const gl_sprite_region_t *region, GLfloat x, GLfloat y,
+		GLfloat scaleX, GLfloat scaleY, GLfloat rotation, GLfloat r,
+		GLfloat g, GLfloat b, GLfloat a) {
+	if (batch->count >= GL_SPRITE_MAX) {
+		return;
+	}
+	// Unit quad corners and matching texture coordinates.
+	const GLfloat corners[4][2] = { { -1, -1 }, { 1, -1 }, { 1, 1 }, { -1, 1 } };
+	const GLfloat texCoords[4][2] = { { region->u0, region->v1 }, { region->u1,
+			region->v1 }, { region->u1, region->v0 }, { region->u0, region->v0 } };
+	GLfloat s = sinf(rotation);
+	GLfloat c = cosf(rotation);
+	GLubyte color[4] = { gl_VertexUByte(r), gl_VertexUByte(g),
+			gl_VertexUByte(b), gl_VertexUByte(a) };
+
+	gl_sprite_vertex_t *vertex = &batch->vertices[batch->count * 4];
+	int idx;
+	for (idx = 0; idx < 4; ++idx, ++vertex) {
+		GLfloat cx = corners[idx][0], cy = corners[idx][1];
+		vertex->x = gl_VertexShort(x + (c * cx - s * cy) * scaleX,
+				GL_SPRITE_RANGE);
+		vertex->y = gl_VertexShort(y + (s * cx + c * cy) * scaleY,
+				GL_SPRITE_RANGE);
+		vertex->u = gl_VertexUShort(texCoords[idx][0]);
+		vertex->v = gl_VertexUShort(texCoords[idx][1]);
+		memcpy(&vertex->r, color, sizeof color);
+	}
+	++batch->count;
+}
+
+void gl_SpriteBatchFlush(gl_sprite_batch_t *batch,
+		const gl_vertex_format_t *format, const GLint *locations) {
+	if (batch->count == 0) {
+		return;
+	}
+	GLsizeiptr size = batch->count * 4 * sizeof(gl_sprite_vertex_t);
+	gl_StateBindBuffer(GL_ARRAY_BUFFER, batch->vertexBuffer);
+	// Respecifying whole buffer lets driver orphan storage
+	// still in use by previous frame instead of stalling.
+	glBufferData(GL_ARRAY_BUFFER, size, batch->vertices, GL_STREAM_DRAW);
+	gl_VertexFormatBind(format, locations, 0);
+
+	gl_StateBindBuffer(GL_ELEMENT_ARRAY_BUFFER, batch->indexBuffer);
+	glDrawElements(GL_TRIANGLES, batch->count * 6, GL_UNSIGNED_SHORT, 0);
+
+	batch->stats.sprites += batch->count;
+	batch->stats.uploadBytes += size;
+	++batch->stats.drawCalls;
+	batch->count = 0;
+}
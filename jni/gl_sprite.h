@@ -0,0 +1,130 @@
+#ifndef GL_SPRITE_H__
+#define GL_SPRITE_H__
+
+#include <GLES2/gl2.h>
+#include "gl_vertex.h"
+
+// Maximum number of sprites in one batch.
+#define GL_SPRITE_MAX 64
+
+// Sprite positions are stored as normalized shorts covering
+// [-GL_SPRITE_RANGE, GL_SPRITE_RANGE] in clip space.
+#define GL_SPRITE_RANGE 2.f
+
+/*
+ Texture coordinates of one image packed into atlas.
+ */
+typedef struct {
+	GLfloat u0;
+	GLfloat v0;
+	GLfloat u1;
+	GLfloat v1;
+} gl_sprite_region_t;
+
+/*
+ Single channel texture atlas. Images are packed into rows
+ on CPU side and uploaded as one texture once all are added.
+ */
+typedef struct {
+	GLuint texture;
+	GLint width;
+	GLint height;
+	GLubyte *pixels;
+	GLint rowX;
+	GLint rowY;
+	GLint rowHeight;
+} gl_sprite_atlas_t;
+
+/*
+ Interleaved vertex written for each sprite corner, quantized
+ as described by gl_SpriteVertexFormat.
+ */
+typedef struct {
+	GLshort x;
+	GLshort y;
+	GLushort u;
+	GLushort v;
+	GLubyte r;
+	GLubyte g;
+	GLubyte b;
+	GLubyte a;
+} gl_sprite_vertex_t;
+
+/*
+ Per frame batch counters.
+ */
+typedef struct {
+	GLuint sprites;
+	GLuint drawCalls;
+	GLuint uploadBytes;
+} gl_sprite_stats_t;
+
+/*
+ Sprite batch rendering all sprites with one draw call
+ from a vertex buffer streamed every frame.
+ */
+typedef struct {
+	GLuint vertexBuffer;
+	GLuint indexBuffer;
+	GLint count;
+	gl_sprite_vertex_t vertices[GL_SPRITE_MAX * 4];
+	gl_sprite_stats_t stats;
+} gl_sprite_batch_t;
+
+/*
+ Allocates CPU side storage for atlas of given size.
+ */
+void gl_SpriteAtlasCreate(gl_sprite_atlas_t *atlas, GLint width, GLint height);
+
+/*
+ Copies image into atlas and stores its texture coordinates into region.
+ Returns GL_FALSE if there is no room left for it.
+ */
+GLboolean gl_SpriteAtlasAdd(gl_sprite_atlas_t *atlas, GLint width,
+		GLint height, const GLubyte *pixels, gl_sprite_region_t *region);
+
+/*
+ Uploads atlas into texture and releases CPU side storage.
+ */
+void gl_SpriteAtlasUpload(gl_sprite_atlas_t *atlas);
+
+void gl_SpriteAtlasRelease(gl_sprite_atlas_t *atlas);
+
+/*
+ Describes gl_sprite_vertex_t with attributes aPosition,
+ aTextureCoord and aColor.
+ */
+void gl_SpriteVertexFormat(gl_vertex_format_t *format);
+
+/*
+ Creates vertex and index buffers for batch.
+ */
+void gl_SpriteBatchCreate(gl_sprite_batch_t *batch);
+
+void gl_SpriteBatchRelease(gl_sprite_batch_t *batch);
+
+/*
+ Starts collecting new set of sprites. Counters from previous
+ frame are copied to lastFrame, if given.
+ */
+void gl_SpriteBatchBegin(gl_sprite_batch_t *batch,
+		gl_sprite_stats_t *lastFrame);
+
+/*
+ Adds sprite centered at x, y. Unit quad is rotated by given angle
+ in radians and then scaled with scaleX and scaleY.
+ */
+void gl_SpriteBatchAdd(gl_sprite_batch_t *batch,
+		const gl_sprite_region_t *region, GLfloat x, GLfloat y,
+		GLfloat scaleX, GLfloat scaleY, GLfloat rotation, GLfloat r,
+		GLfloat g, GLfloat b, GLfloat a);
+
+/*
+ Uploads collected sprites and draws them with currently used program
+ and bound atlas texture. Locations are those of gl_SpriteVertexFormat
+ attributes, as returned by gl_VertexFormatLocations.
+ */
+void gl_SpriteBatchFlush(gl_sprite_batch_t *batch,
+		const gl_vertex_format_t *format, const GLint *locations);
+
+#endif
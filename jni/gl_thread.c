@@ -15,7 +15,9 @@
  */
 
 #include <stdlib.h>
+#include <string.h>
 #include <pthread.h>
+#include "flowers_clock.h"
 #include "gl_thread.h"
 #include "log.h"
 
@@ -29,6 +31,7 @@ typedef struct {
 
 	gl_thread_bool_t threadCreated;
 	gl_thread_bool_t threadPause;
+	gl_thread_bool_t threadPrewarm;
 	gl_thread_bool_t threadExit;
 	gl_thread_bool_t windowChanged;
 	gl_thread_bool_t windowSizeChanged;
@@ -36,15 +39,23 @@ typedef struct {
 	ANativeWindow *window;
 	int32_t windowWidth;
 	int32_t windowHeight;
+
+	flowers_nanos_t createTime;
+	int32_t firstFrameMillis;
 } gl_thread_global_t;
 gl_thread_global_t GLOBALS;
 
+// Serializes all public functions. Thread creation and destruction
+// can't interleave with callers from other threads this way.
+pthread_mutex_t gl_thread_api_mutex = PTHREAD_MUTEX_INITIALIZER;
+
 // EGL structure for storing EGL related variables.
 typedef struct {
 	EGLDisplay display;
 	EGLContext context;
 	EGLConfig config;
 	EGLSurface surface;
+	EGLSurface pbuffer;
 } gl_thread_egl_t;
 
 // Initializes EGL context. Uses chooseConfig callback
@@ -68,15 +79,26 @@ gl_thread_bool_t gl_ContextCreate(gl_thread_egl_t *egl,
 		goto error;
 	}
 
-	EGLint numConfigs;
+	EGLint numConfigs = 0;
+	// Prefer configurations supporting pbuffers too, these are used
+	// for making context current before window exists. Surface type
+	// is the second last attribute.
 	EGLint configAttrs[] = { EGL_RED_SIZE, 4, EGL_GREEN_SIZE, 4, EGL_BLUE_SIZE,
 			4, EGL_ALPHA_SIZE, 0, EGL_DEPTH_SIZE, 0, EGL_STENCIL_SIZE, 0,
-			EGL_NONE };
+			EGL_SURFACE_TYPE, EGL_WINDOW_BIT | EGL_PBUFFER_BIT, EGL_NONE };
+	EGLint *surfaceType = &configAttrs[sizeof configAttrs
+			/ sizeof configAttrs[0] - 2];
 
 	// Try to get available configuration count.
 	if (eglChooseConfig(egl->display, configAttrs, NULL, 0,
-			&numConfigs) != EGL_TRUE) {
-		goto error;
+			&numConfigs) != EGL_TRUE || numConfigs <= 0) {
+		// Fall back to window only configurations. Pbuffer creation
+		// fails then and onContextCreated waits for first frame.
+		*surfaceType = EGL_WINDOW_BIT;
+		if (eglChooseConfig(egl->display, configAttrs, NULL, 0,
+				&numConfigs) != EGL_TRUE) {
+			goto error;
+		}
 	}
 	// If configuration count <= 0.
 	if (numConfigs <= 0) {
@@ -111,6 +133,13 @@ gl_thread_bool_t gl_ContextCreate(gl_thread_egl_t *egl,
 		goto error;
 	}
 
+	// Create small offscreen surface for making context current without
+	// a window. Failing here is not fatal, it only means context can't
+	// be used before gl_SurfaceCreate.
+	EGLint pbufferAttrs[] = { EGL_WIDTH, 1, EGL_HEIGHT, 1, EGL_NONE };
+	egl->pbuffer = eglCreatePbufferSurface(egl->display, egl->config,
+			pbufferAttrs);
+
 	// On success return true.
 	return GL_THREAD_TRUE;
 
@@ -135,6 +164,10 @@ void gl_ContextDestroy(gl_thread_egl_t *egl) {
 		// Release surface and context from current thread.
 		eglMakeCurrent(egl->display, EGL_NO_SURFACE, EGL_NO_SURFACE,
 				EGL_NO_CONTEXT);
+		// If we have offscreen surface, destroy it.
+		if (egl->pbuffer != EGL_NO_SURFACE) {
+			eglDestroySurface(egl->display, egl->pbuffer);
+		}
 		// If we have a context, destroy it.
 		if (egl->context != EGL_NO_CONTEXT) {
 			eglDestroyContext(egl->display, egl->context);
@@ -145,6 +178,20 @@ void gl_ContextDestroy(gl_thread_egl_t *egl) {
 	egl->display = EGL_NO_DISPLAY;
 	egl->context = EGL_NO_CONTEXT;
 	egl->surface = EGL_NO_SURFACE;
+	egl->pbuffer = EGL_NO_SURFACE;
+}
+
+// Make context current using offscreen surface.
+gl_thread_bool_t gl_ContextMakeCurrent(gl_thread_egl_t *egl) {
+	if (egl->display == EGL_NO_DISPLAY || egl->context == EGL_NO_CONTEXT
+			|| egl->pbuffer == EGL_NO_SURFACE) {
+		return GL_THREAD_FALSE;
+	}
+	if (eglMakeCurrent(egl->display, egl->pbuffer, egl->pbuffer,
+			egl->context) != EGL_TRUE) {
+		return GL_THREAD_FALSE;
+	}
+	return GL_THREAD_TRUE;
 }
 
 // Create EGL surface.
@@ -189,6 +236,17 @@ void gl_SurfaceDestroy(gl_thread_egl_t *egl) {
 	egl->surface = EGL_NO_SURFACE;
 }
 
+// Lets onContextDestroyed release GL objects before context goes away.
+// Context has to be current, it's made current with pbuffer again if
+// window surface is already gone. Without either one objects are
+// released along with context only.
+void gl_ContextNotifyDestroyed(gl_thread_egl_t *egl,
+		gl_thread_bool_t hasSurface, gl_thread_funcs_t *funcs) {
+	if (hasSurface || gl_ContextMakeCurrent(egl)) {
+		funcs->onContextDestroyed();
+	}
+}
+
 // Main rendering thread function.
 void* gl_Thread(void *startParams) {
 
@@ -196,10 +254,12 @@ void* gl_Thread(void *startParams) {
 
 	gl_thread_funcs_t *funcs = startParams;
 	gl_thread_egl_t egl;
+	memset(&egl, 0, sizeof egl);
 
 	int width = 0, height = 0;
 	gl_thread_bool_t hasContext = GL_THREAD_FALSE;
 	gl_thread_bool_t hasSurface = GL_THREAD_FALSE;
+	gl_thread_bool_t notifyContextCreated = GL_THREAD_FALSE;
 	gl_thread_bool_t notifySurfaceCreated = GL_THREAD_FALSE;
 	gl_thread_bool_t notifySurfaceChanged = GL_THREAD_FALSE;
 
@@ -212,8 +272,13 @@ void* gl_Thread(void *startParams) {
 		// Inner event loop in which rendering context
 		// changes are being handled.
 		while (!GLOBALS.threadExit) {
-			// If we're asked to pause, release whole EGL context.
-			if (GLOBALS.threadPause && hasContext) {
+			// If we're asked to pause, release whole EGL context. Context
+			// created eagerly is kept until explicitly paused though.
+			if (GLOBALS.threadPause && !GLOBALS.threadPrewarm && hasContext) {
+				if (!notifyContextCreated) {
+					gl_ContextNotifyDestroyed(&egl, hasSurface, funcs);
+				}
+				notifyContextCreated = GL_THREAD_FALSE;
 				gl_SurfaceDestroy(&egl);
 				gl_ContextDestroy(&egl);
 				hasContext = GL_THREAD_FALSE;
@@ -228,19 +293,30 @@ void* gl_Thread(void *startParams) {
 				}
 			}
 			// If we're asked to continue, recreate EGL context and surface.
-			if (!GLOBALS.threadPause && !hasContext) {
+			if ((!GLOBALS.threadPause || GLOBALS.threadPrewarm) && !hasContext) {
 				hasContext = gl_ContextCreate(&egl, funcs->chooseConfig);
+				notifyContextCreated = hasContext;
 				if (!hasContext) {
-					LOGD("gl_Thread", "gl_ContextCreate failed");
+					LOGW("gl_Thread", "gl_ContextCreate failed");
 				}
 			}
+			// Let new context do its initialization right away if it
+			// can be made current without window surface. Mutex is
+			// held like for every other callback, gl_ThreadLock users
+			// may touch the same renderer state.
+			if (notifyContextCreated && !hasSurface
+					&& gl_ContextMakeCurrent(&egl)) {
+				notifyContextCreated = GL_THREAD_FALSE;
+				funcs->onContextCreated();
+				continue;
+			}
 			// NOTE: this handles also situations in which surface
 			// only was deleted/changed (GLOBALS.windowChanged).
 			if (!GLOBALS.threadPause && hasContext && !hasSurface) {
 				hasSurface = gl_SurfaceCreate(&egl, GLOBALS.window);
 				notifySurfaceCreated = hasSurface;
 				if (!hasSurface) {
-					LOGD("gl_Thread", "gl_SurfaceCreate failed");
+					LOGW("gl_Thread", "gl_SurfaceCreate failed");
 				}
 			}
 			// If there's windowSizeChanged pending
@@ -259,11 +335,12 @@ void* gl_Thread(void *startParams) {
 			// mutex lock requests being made, in which case we try
 			// to give them execution time first.
 			if (hasContext && hasSurface && width > 0 && height > 0
-					&& GLOBALS.mutexCounter == 0) {
+					&& __atomic_load_n(&GLOBALS.mutexCounter,
+							__ATOMIC_SEQ_CST) == 0) {
 				break;
 			}
 
-			LOGD("gl_Thread", "wait");
+			LOGV("gl_Thread", "wait");
 
 			// Releases mutex and waits for cond to be triggered.
 			// If there are pending mutex lock requests they ought
@@ -278,6 +355,11 @@ void* gl_Thread(void *startParams) {
 			break;
 		}
 
+		// If context wasn't initialized yet do it now.
+		if (notifyContextCreated) {
+			notifyContextCreated = GL_THREAD_FALSE;
+			funcs->onContextCreated();
+		}
 		// If new surface was created do notifying.
 		if (notifySurfaceCreated) {
 			notifySurfaceCreated = GL_THREAD_FALSE;
@@ -299,6 +381,20 @@ void* gl_Thread(void *startParams) {
 		// printed on error console but haven't
 		// found a way to prevent it from happening.
 		eglSwapBuffers(egl.display, egl.surface);
+
+		// Store time it took to get first frame on screen.
+		if (GLOBALS.firstFrameMillis < 0) {
+			__atomic_store_n(&GLOBALS.firstFrameMillis, (flowers_ClockNanos()
+					- GLOBALS.createTime) / 1000000, __ATOMIC_RELAXED);
+			LOGD("gl_Thread", "time to first frame %d ms",
+					GLOBALS.firstFrameMillis);
+		}
+	}
+
+	// Context which onContextCreated was called for gets released
+	// while still holding mutex, same as other callbacks.
+	if (hasContext && !notifyContextCreated) {
+		gl_ContextNotifyDestroyed(&egl, hasSurface, funcs);
 	}
 
 	// Release mutex.
@@ -320,41 +416,25 @@ gl_thread_bool_t gl_ThreadRunning() {
 	return GL_THREAD_FALSE;
 }
 
-void gl_ThreadCreate(gl_thread_funcs_t *threadFuncs) {
-	// If there's thread running, stop it.
-	if (GLOBALS.threadCreated) {
-		gl_ThreadDestroy();
-	}
-	// Initialize new thread.
-	// TODO: It might be a good idea to add some error checking.
-	GLOBALS.threadCreated = GL_THREAD_TRUE;
-	GLOBALS.threadPause = GL_THREAD_TRUE;
-	pthread_cond_init(&GLOBALS.cond, NULL);
-	pthread_mutex_init(&GLOBALS.mutex, NULL);
-	pthread_create(&GLOBALS.thread, NULL, gl_Thread, threadFuncs);
-}
-
-void gl_ThreadDestroy() {
+// Stops and releases current thread. Caller has to hold API mutex.
+void gl_ThreadDestroyLocked() {
 	// If there's thread running.
 	if (GLOBALS.threadCreated) {
-		// Mark exit flag.
+		// Mark exit flag and notify thread. This is done while holding
+		// mutex so that notification can't get lost between thread
+		// checking exit flag and going to wait. Rendering thread gives
+		// up mutex only if there are pending lock requests.
+		__atomic_add_fetch(&GLOBALS.mutexCounter, 1, __ATOMIC_SEQ_CST);
+		pthread_mutex_lock(&GLOBALS.mutex);
 		GLOBALS.threadExit = GL_THREAD_TRUE;
-		// Notify thread.
-		pthread_cond_signal(&GLOBALS.cond);
+		__atomic_sub_fetch(&GLOBALS.mutexCounter, 1, __ATOMIC_SEQ_CST);
+		pthread_cond_broadcast(&GLOBALS.cond);
+		pthread_mutex_unlock(&GLOBALS.mutex);
 		// Wait until thread has exited.
 		pthread_join(GLOBALS.thread, NULL);
 
-		// If there are pending mutex locks let
-		// them execute before destroying it.
-		// This is needed because otherwise
-		// pthread_mutex_destroy will fail.
-		pthread_mutex_lock(&GLOBALS.mutex);
-		while (GLOBALS.mutexCounter > 0) {
-			pthread_cond_wait(&GLOBALS.cond, &GLOBALS.mutex);
-		}
-		pthread_mutex_unlock(&GLOBALS.mutex);
-
-		// Release all GLOBALS data.
+		// There can't be anyone else holding or waiting for mutex
+		// at this point as gl_ThreadLock requires API mutex too.
 		pthread_cond_destroy(&GLOBALS.cond);
 		pthread_mutex_destroy(&GLOBALS.mutex);
 		// If we're holding a window release it.
@@ -365,30 +445,56 @@ void gl_ThreadDestroy() {
 	}
 }
 
+void gl_ThreadCreate(gl_thread_funcs_t *threadFuncs, gl_thread_bool_t eager) {
+	pthread_mutex_lock(&gl_thread_api_mutex);
+	// If there's thread running, stop it.
+	gl_ThreadDestroyLocked();
+	// Initialize new thread.
+	// TODO: It might be a good idea to add some error checking.
+	GLOBALS.threadCreated = GL_THREAD_TRUE;
+	GLOBALS.threadPause = GL_THREAD_TRUE;
+	GLOBALS.threadPrewarm = eager;
+	GLOBALS.createTime = flowers_ClockNanos();
+	GLOBALS.firstFrameMillis = -1;
+	pthread_cond_init(&GLOBALS.cond, NULL);
+	pthread_mutex_init(&GLOBALS.mutex, NULL);
+	pthread_create(&GLOBALS.thread, NULL, gl_Thread, threadFuncs);
+	pthread_mutex_unlock(&gl_thread_api_mutex);
+}
+
+void gl_ThreadDestroy() {
+	pthread_mutex_lock(&gl_thread_api_mutex);
+	gl_ThreadDestroyLocked();
+	pthread_mutex_unlock(&gl_thread_api_mutex);
+}
+
 void gl_ThreadSetPaused(gl_thread_bool_t paused) {
+	// Acquire thread lock.
+	gl_ThreadLock();
 	if (gl_ThreadRunning()) {
-		// Acquire thread lock.
-		gl_ThreadLock();
-		// Set thread paused flag.
+		// Set thread paused flag. Explicit request ends eager
+		// startup phase during which context is kept regardless.
 		GLOBALS.threadPause = paused;
-		// Release thread lock.
-		gl_ThreadUnlock();
+		GLOBALS.threadPrewarm = GL_THREAD_FALSE;
 	}
+	// Release thread lock.
+	gl_ThreadUnlock();
 }
 
 // Sets new native window for creating EGLSurface.
 void gl_ThreadSetWindow(ANativeWindow* window) {
+	// Acquire thread lock.
+	gl_ThreadLock();
 	// We accept new window only when rendering
 	// thread is active. Otherwise we can't promise
 	// it gets released as expected.
 	if (!gl_ThreadRunning()) {
-		ANativeWindow_release(window);
-		return;
+		if (window) {
+			ANativeWindow_release(window);
+		}
 	}
-	// Acquire thread lock.
-	gl_ThreadLock();
 	// If we have new nativeWin.
-	if (GLOBALS.window != window) {
+	else if (GLOBALS.window != window) {
 		// If there is old one, release it first.
 		if (GLOBALS.window) {
 			ANativeWindow_release(GLOBALS.window);
@@ -410,15 +516,12 @@ void gl_ThreadSetWindow(ANativeWindow* window) {
 }
 
 void gl_ThreadSetWindowSize(int32_t width, int32_t height) {
-	// We accept new size only when rendering
-	// thread is running.
-	if (!gl_ThreadRunning()) {
-		return;
-	}
 	// Acquire thread lock.
 	gl_ThreadLock();
-	// If we received new size.
-	if (GLOBALS.windowWidth != width || GLOBALS.windowHeight != height) {
+	// We accept new size only when rendering thread is
+	// running and if we received new size.
+	if (gl_ThreadRunning()
+			&& (GLOBALS.windowWidth != width || GLOBALS.windowHeight != height)) {
 		// Store new dimensions.
 		GLOBALS.windowWidth = width;
 		GLOBALS.windowHeight = height;
@@ -429,17 +532,31 @@ void gl_ThreadSetWindowSize(int32_t width, int32_t height) {
 	gl_ThreadUnlock();
 }
 
+int32_t gl_ThreadGetFirstFrameMillis() {
+	pthread_mutex_lock(&gl_thread_api_mutex);
+	int32_t millis = __atomic_load_n(&GLOBALS.firstFrameMillis,
+			__ATOMIC_RELAXED);
+	pthread_mutex_unlock(&gl_thread_api_mutex);
+	return millis;
+}
+
 void gl_ThreadLock() {
-	if (gl_ThreadRunning()) {
-		++GLOBALS.mutexCounter;
+	pthread_mutex_lock(&gl_thread_api_mutex);
+	if (GLOBALS.threadCreated) {
+		// Let rendering thread know there's someone waiting
+		// so that it gives up mutex as soon as possible.
+		__atomic_add_fetch(&GLOBALS.mutexCounter, 1, __ATOMIC_SEQ_CST);
 		pthread_mutex_lock(&GLOBALS.mutex);
 	}
 }
 
 void gl_ThreadUnlock() {
-	if (gl_ThreadRunning()) {
-		--GLOBALS.mutexCounter;
+	if (GLOBALS.threadCreated) {
+		__atomic_sub_fetch(&GLOBALS.mutexCounter, 1, __ATOMIC_SEQ_CST);
+		// Signal while still holding mutex, rendering
+		// thread can't miss it this way.
+		pthread_cond_broadcast(&GLOBALS.cond);
 		pthread_mutex_unlock(&GLOBALS.mutex);
-		pthread_cond_signal(&GLOBALS.cond);
 	}
+	pthread_mutex_unlock(&gl_thread_api_mutex);
 }
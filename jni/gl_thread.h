@@ -33,15 +33,23 @@ typedef unsigned char gl_thread_bool_t;
 typedef EGLConfig (*gl_ChooseConfig_t)(EGLDisplay display,
 		EGLConfig* configArray, int configCount);
 typedef void (*gl_OnRenderFrame_t)(void);
+typedef void (*gl_OnContextCreated_t)(void);
+typedef void (*gl_OnContextDestroyed_t)(void);
 typedef void (*gl_OnSurfaceCreated_t)(void);
 typedef void (*gl_OnSurfaceChanged_t)(int32_t width, int32_t height);
 
 /*
- Callback functions struct definition.
+ Callback functions struct definition. onContextDestroyed is called for
+ context onContextCreated was called for, right before it's released and
+ while it's still current. It's skipped if neither window surface nor
+ pbuffer is left for making context current, GL objects are released
+ along with context then.
  */
 typedef struct {
 	gl_ChooseConfig_t chooseConfig;
 	gl_OnRenderFrame_t onRenderFrame;
+	gl_OnContextCreated_t onContextCreated;
+	gl_OnContextDestroyed_t onContextDestroyed;
 	gl_OnSurfaceCreated_t onSurfaceCreated;
 	gl_OnSurfaceChanged_t onSurfaceChanged;
 } gl_thread_funcs_t;
@@ -49,9 +57,15 @@ typedef struct {
 /*
  Creates a new gl thread. If there is a thread running already it is always
  stopped before creating a new one. Meaning ultimately that there is exactly
- one thread running at all times. Thread is initially in paused state.
+ one thread running at all times. Thread is initially in paused state,
+ it doesn't render before gl_ThreadSetPaused(GL_THREAD_FALSE).
+
+ If eager is set thread creates EGL context and calls onContextCreated
+ right away using an offscreen surface, without waiting for window or
+ being unpaused. Context is kept until thread is explicitly paused.
+ Otherwise context is created only once thread is unpaused.
  */
-void gl_ThreadCreate(gl_thread_funcs_t *threadFuncs);
+void gl_ThreadCreate(gl_thread_funcs_t *threadFuncs, gl_thread_bool_t eager);
 
 /*
  Destroys current thread if there is one. Returns only after thread
@@ -74,12 +88,19 @@ void gl_ThreadSetWindow(ANativeWindow* window);
  */
 void gl_ThreadSetWindowSize(int32_t width, int32_t height);
 
+/*
+ Returns time in milliseconds from gl_ThreadCreate until first frame
+ was swapped on screen, or -1 if there hasn't been one yet.
+ */
+int32_t gl_ThreadGetFirstFrameMillis();
+
 /*
  Locks render thread for communicating with it safely. You
  have to call gl_ThreadUnlock after you're done with
  lock in order to let rendering thread continue.
  gl_ThreadLock returns only after it has received
- lock for rendering thread.
+ lock for rendering thread. All functions above take
+ this lock, none of them may be called while holding it.
  */
 void gl_ThreadLock();
 
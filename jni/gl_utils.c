@@ -1,7 +1,278 @@
 #include <stdlib.h>
+#include <string.h>
 #include "gl_utils.h"
+#include "gl_capture.h"
 #include "log.h"
 
+// Maximum number of shadowed vertex attributes, texture units and uniforms.
+#define GL_STATE_ATTRIB_MAX   32
+#define GL_STATE_TEXTURE_MAX  8
+#define GL_STATE_UNIFORM_MAX  64
+
+// Shadowed uniform value. Integer values are stored as their bit patterns
+// so that comparison can be done with memcmp for all types.
+typedef struct {
+	GLuint program;
+	GLint location;
+	GLint count;
+	GLfloat value[4];
+} gl_state_uniform_t;
+
+// Shadow copy of GL state known to be set on current context.
+#define STATE gl_utils_state
+typedef struct {
+	GLboolean valid;
+	GLuint program;
+	GLuint enabledAttribs;
+	GLuint arrayBuffer;
+	GLuint elementArrayBuffer;
+	GLuint activeTexture;
+	GLuint textures[GL_STATE_TEXTURE_MAX];
+	GLboolean blend;
+	GLenum blendSrc;
+	GLenum blendDst;
+	GLint uniformCount;
+	gl_state_uniform_t uniforms[GL_STATE_UNIFORM_MAX];
+	gl_utils_stats_t stats;
+} gl_utils_state_t;
+gl_utils_state_t STATE;
+
+// Drops cached uniform values of given program. Program names
+// are reused by GL once deleted so these must not stay around.
+void gl_StateForgetProgram(GLuint program) {
+	GLint idx = 0;
+	while (idx < STATE.uniformCount) {
+		if (STATE.uniforms[idx].program == program) {
+			STATE.uniforms[idx] = STATE.uniforms[--STATE.uniformCount];
+		} else {
+			++idx;
+		}
+	}
+	if (STATE.program == program) {
+		STATE.program = 0;
+	}
+}
+
+void gl_StateForgetBuffer(GLuint buffer) {
+	if (STATE.arrayBuffer == buffer) {
+		STATE.arrayBuffer = 0;
+	}
+	if (STATE.elementArrayBuffer == buffer) {
+		STATE.elementArrayBuffer = 0;
+	}
+}
+
+void gl_StateForgetTexture(GLuint texture) {
+	GLint unit;
+	for (unit = 0; unit < GL_STATE_TEXTURE_MAX; ++unit) {
+		if (STATE.textures[unit] == texture) {
+			STATE.textures[unit] = 0;
+		}
+	}
+}
+
+// Compares value against shadowed uniform value and updates it. Returns
+// GL_TRUE if value changed and GL call has to be issued.
+GLboolean gl_StateUniformChanged(GLint location, GLint count,
+		const GLfloat *value) {
+	if (!STATE.valid) {
+		++STATE.stats.issued;
+		return GL_TRUE;
+	}
+	if (location == -1) {
+		++STATE.stats.skipped;
+		return GL_FALSE;
+	}
+	GLint idx;
+	gl_state_uniform_t *uniform = NULL;
+	for (idx = 0; idx < STATE.uniformCount; ++idx) {
+		if (STATE.uniforms[idx].program == STATE.program
+				&& STATE.uniforms[idx].location == location) {
+			uniform = &STATE.uniforms[idx];
+			break;
+		}
+	}
+	if (uniform && uniform->count == count
+			&& memcmp(uniform->value, value, count * sizeof(GLfloat)) == 0) {
+		++STATE.stats.skipped;
+		return GL_FALSE;
+	}
+	// If there's no entry for this uniform yet, allocate one. Once
+	// table is full values are simply passed through uncached.
+	if (uniform == NULL && STATE.uniformCount < GL_STATE_UNIFORM_MAX) {
+		uniform = &STATE.uniforms[STATE.uniformCount++];
+		uniform->program = STATE.program;
+		uniform->location = location;
+	}
+	if (uniform) {
+		uniform->count = count;
+		memcpy(uniform->value, value, count * sizeof(GLfloat));
+	}
+	++STATE.stats.issued;
+	return GL_TRUE;
+}
+
+void gl_StateReset() {
+	memset(&STATE, 0, sizeof STATE);
+	STATE.activeTexture = GL_TEXTURE0;
+	STATE.blendSrc = GL_ONE;
+	STATE.blendDst = GL_ZERO;
+	STATE.valid = GL_TRUE;
+}
+
+void gl_StateFrameBegin(gl_utils_stats_t *lastFrame) {
+	if (lastFrame) {
+		*lastFrame = STATE.stats;
+	}
+	memset(&STATE.stats, 0, sizeof STATE.stats);
+}
+
+void gl_StateUseProgram(GLuint program) {
+	if (STATE.valid && STATE.program == program) {
+		++STATE.stats.skipped;
+		return;
+	}
+	glUseProgram(program);
+	STATE.program = program;
+	++STATE.stats.issued;
+}
+
+void gl_StateEnableVertexAttribArray(GLint index) {
+	if (index < 0 || index >= GL_STATE_ATTRIB_MAX) {
+		return;
+	}
+	GLuint bit = 1u << index;
+	if (STATE.valid && (STATE.enabledAttribs & bit)) {
+		++STATE.stats.skipped;
+		return;
+	}
+	glEnableVertexAttribArray(index);
+	STATE.enabledAttribs |= bit;
+	++STATE.stats.issued;
+}
+
+void gl_StateDisableVertexAttribArray(GLint index) {
+	if (index < 0 || index >= GL_STATE_ATTRIB_MAX) {
+		return;
+	}
+	GLuint bit = 1u << index;
+	if (STATE.valid && !(STATE.enabledAttribs & bit)) {
+		++STATE.stats.skipped;
+		return;
+	}
+	glDisableVertexAttribArray(index);
+	STATE.enabledAttribs &= ~bit;
+	++STATE.stats.issued;
+}
+
+// Enables vertex attribute arrays with bit set in mask
+// and disables all the others.
+void gl_StateVertexAttribArrays(GLuint mask) {
+	GLint index;
+	for (index = 0; index < GL_STATE_ATTRIB_MAX; ++index) {
+		GLuint bit = 1u << index;
+		if (mask & bit) {
+			gl_StateEnableVertexAttribArray(index);
+		} else if (STATE.enabledAttribs & bit) {
+			gl_StateDisableVertexAttribArray(index);
+		}
+	}
+}
+
+void gl_StateBindBuffer(GLenum target, GLuint buffer) {
+	GLuint *bound = target == GL_ARRAY_BUFFER ?
+			&STATE.arrayBuffer : &STATE.elementArrayBuffer;
+	if (STATE.valid && *bound == buffer) {
+		++STATE.stats.skipped;
+		return;
+	}
+	glBindBuffer(target, buffer);
+	*bound = buffer;
+	++STATE.stats.issued;
+}
+
+void gl_StateActiveTexture(GLenum unit) {
+	if (STATE.valid && STATE.activeTexture == unit) {
+		++STATE.stats.skipped;
+		return;
+	}
+	glActiveTexture(unit);
+	STATE.activeTexture = unit;
+	++STATE.stats.issued;
+}
+
+void gl_StateBindTexture(GLuint texture) {
+	GLuint unit = STATE.activeTexture - GL_TEXTURE0;
+	if (unit >= GL_STATE_TEXTURE_MAX) {
+		glBindTexture(GL_TEXTURE_2D, texture);
+		++STATE.stats.issued;
+		return;
+	}
+	if (STATE.valid && STATE.textures[unit] == texture) {
+		++STATE.stats.skipped;
+		return;
+	}
+	glBindTexture(GL_TEXTURE_2D, texture);
+	STATE.textures[unit] = texture;
+	++STATE.stats.issued;
+}
+
+void gl_StateSetBlend(GLboolean enabled) {
+	if (STATE.valid && STATE.blend == enabled) {
+		++STATE.stats.skipped;
+		return;
+	}
+	if (enabled) {
+		glEnable(GL_BLEND);
+	} else {
+		glDisable(GL_BLEND);
+	}
+	STATE.blend = enabled;
+	++STATE.stats.issued;
+}
+
+void gl_StateBlendFunc(GLenum srcFactor, GLenum dstFactor) {
+	if (STATE.valid && STATE.blendSrc == srcFactor
+			&& STATE.blendDst == dstFactor) {
+		++STATE.stats.skipped;
+		return;
+	}
+	glBlendFunc(srcFactor, dstFactor);
+	STATE.blendSrc = srcFactor;
+	STATE.blendDst = dstFactor;
+	++STATE.stats.issued;
+}
+
+void gl_StateUniform1i(GLint location, GLint x) {
+	GLfloat value[1];
+	memcpy(value, &x, sizeof x);
+	if (gl_StateUniformChanged(location, 1, value)) {
+		glUniform1i(location, x);
+	}
+}
+
+void gl_StateUniform1f(GLint location, GLfloat x) {
+	GLfloat value[1] = { x };
+	if (gl_StateUniformChanged(location, 1, value)) {
+		glUniform1f(location, x);
+	}
+}
+
+void gl_StateUniform2f(GLint location, GLfloat x, GLfloat y) {
+	GLfloat value[2] = { x, y };
+	if (gl_StateUniformChanged(location, 2, value)) {
+		glUniform2f(location, x, y);
+	}
+}
+
+void gl_StateUniform4f(GLint location, GLfloat x, GLfloat y, GLfloat z,
+		GLfloat w) {
+	GLfloat value[4] = { x, y, z, w };
+	if (gl_StateUniformChanged(location, 4, value)) {
+		glUniform4f(location, x, y, z, w);
+	}
+}
+
 GLuint gl_ShaderCreate(GLenum type, const GLchar *source) {
 	GLuint shader = glCreateShader(type);
 	LOGD("gl_ShaderCreate", "shader=%d", shader);
@@ -11,7 +282,7 @@ GLuint gl_ShaderCreate(GLenum type, const GLchar *source) {
 		int compiled;
 		glGetShaderiv(shader, GL_COMPILE_STATUS, &compiled);
 		if (compiled != GL_TRUE) {
-			LOGD("gl_ShaderCreate", "shader=%d failed", shader);
+			LOGE("gl_ShaderCreate", "shader=%d failed", shader);
 			glDeleteShader(shader);
 			shader = 0;
 		}
@@ -32,13 +303,14 @@ void gl_ProgramCreate(gl_utils_program_t *shader, const GLchar *vertexShader,
 		int linkStatus;
 		glGetProgramiv(shader->program, GL_LINK_STATUS, &linkStatus);
 		if (linkStatus != GL_TRUE) {
-			LOGD("gl_ProgramCreate", "program=%d failed", shader->program);
+			LOGE("gl_ProgramCreate", "program=%d failed", shader->program);
 			gl_ProgramRelease(shader);
 		}
 	}
 }
 
 void gl_ProgramRelease(gl_utils_program_t *shader) {
+	gl_StateForgetProgram(shader->program);
 	glDeleteProgram(shader->program);
 	glDeleteShader(shader->shader_f);
 	glDeleteShader(shader->shader_v);
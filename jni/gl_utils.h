@@ -9,6 +9,14 @@ typedef struct {
 	GLuint shader_f;
 } gl_utils_program_t;
 
+/*
+ Counters for GL state calls passed to driver versus dropped as redundant.
+ */
+typedef struct {
+	GLuint issued;
+	GLuint skipped;
+} gl_utils_stats_t;
+
 void gl_ProgramCreate(gl_utils_program_t *program, const GLchar *vertexShader,
 		const GLchar *fragmentShader);
 
@@ -16,4 +24,48 @@ void gl_ProgramRelease(gl_utils_program_t *program);
 
 GLint gl_ProgramGetLocation(const GLuint program, const GLchar *name);
 
+/*
+ Forgets all shadowed GL state. Has to be called once new EGL context
+ has been made current as cached values do not apply to it anymore.
+ */
+void gl_StateReset();
+
+/*
+ Marks beginning of a new frame. Counters collected during previous
+ frame are copied to lastFrame, if given, and reset to zero.
+ */
+void gl_StateFrameBegin(gl_utils_stats_t *lastFrame);
+
+/*
+ State setters which call underlying GL function only if
+ value differs from currently shadowed one.
+ */
+void gl_StateUseProgram(GLuint program);
+void gl_StateEnableVertexAttribArray(GLint index);
+void gl_StateDisableVertexAttribArray(GLint index);
+void gl_StateVertexAttribArrays(GLuint mask);
+void gl_StateBindBuffer(GLenum target, GLuint buffer);
+void gl_StateActiveTexture(GLenum unit);
+void gl_StateBindTexture(GLuint texture);
+void gl_StateSetBlend(GLboolean enabled);
+void gl_StateBlendFunc(GLenum srcFactor, GLenum dstFactor);
+
+/*
+ Uniform setters. Values are shadowed per currently used program
+ and location, meaning gl_StateUseProgram has to be called first.
+ */
+void gl_StateUniform1i(GLint location, GLint x);
+void gl_StateUniform1f(GLint location, GLfloat x);
+void gl_StateUniform2f(GLint location, GLfloat x, GLfloat y);
+void gl_StateUniform4f(GLint location, GLfloat x, GLfloat y, GLfloat z,
+		GLfloat w);
+
+/*
+ Drops shadowed bindings of given object. Has to be called before
+ deleting a buffer or texture, GL resets these bindings to zero and
+ reuses object names afterwards.
+ */
+void gl_StateForgetBuffer(GLuint buffer);
+void gl_StateForgetTexture(GLuint texture);
+
 #endif
@@ -0,0 +1,125 @@
+#include <stdio.h>
+#include <string.h>
+#include "gl_vertex.h"
+#include "gl_utils.h"
+#include "gl_capture.h"
+
+// Returns GL_TRUE if attribute is used by shader as it is stored.
+GLboolean gl_VertexAttribIdentity(const gl_vertex_attrib_t *attrib) {
+	GLint idx;
+	for (idx = 0; idx < attrib->size; ++idx) {
+		if (attrib->scale[idx] != 1.f || attrib->bias[idx] != 0.f) {
+			return GL_FALSE;
+		}
+	}
+	return GL_TRUE;
+}
+
+// Appends vecN constant, or float if size is one, into out.
+int gl_VertexWriteVec(GLchar *out, GLsizei outSize, GLint size,
+		const GLfloat *values) {
+	int len = size == 1 ?
+			snprintf(out, outSize, "float(") :
+			snprintf(out, outSize, "vec%d(", size);
+	GLint idx;
+	for (idx = 0; idx < size && len < outSize; ++idx) {
+		len += snprintf(out + len, outSize - len, idx ? ", %f" : "%f",
+				values[idx]);
+	}
+	if (len < outSize) {
+		len += snprintf(out + len, outSize - len, ")");
+	}
+	return len;
+}
+
+void gl_VertexFormatInit(gl_vertex_format_t *format, GLsizei stride) {
+	memset(format, 0, sizeof *format);
+	format->stride = stride;
+}
+
+void gl_VertexFormatAdd(gl_vertex_format_t *format, const GLchar *name,
+		GLint size, GLenum type, GLboolean normalized, GLint offset,
+		const GLfloat *scale, const GLfloat *bias) {
+	if (format->count >= GL_VERTEX_ATTRIB_MAX) {
+		return;
+	}
+	gl_vertex_attrib_t *attrib = &format->attribs[format->count++];
+	strncpy(attrib->name, name, GL_VERTEX_NAME_MAX - 1);
+	attrib->size = size;
+	attrib->type = type;
+	attrib->normalized = normalized;
+	attrib->offset = offset;
+	GLint idx;
+	for (idx = 0; idx < 4; ++idx) {
+		attrib->scale[idx] = scale && idx < size ? scale[idx] : 1.f;
+		attrib->bias[idx] = bias && idx < size ? bias[idx] : 0.f;
+	}
+}
+
+GLboolean gl_VertexFormatShader(const gl_vertex_format_t *format,
+		const GLchar *body, GLchar *out, GLsizei outSize) {
+	int len = 0;
+	GLint idx;
+	for (idx = 0; idx < format->count && len < outSize; ++idx) {
+		const gl_vertex_attrib_t *attrib = &format->attribs[idx];
+		const char *type = attrib->size == 1 ? "float" :
+				attrib->size == 2 ? "vec2" : attrib->size == 3 ? "vec3" : "vec4";
+		if (gl_VertexAttribIdentity(attrib)) {
+			len += snprintf(out + len, outSize - len, "attribute %s %s;\n",
+					type, attrib->name);
+			continue;
+		}
+		// Decode with a macro so that body can use attribute
+		// name as is regardless of how it's stored.
+		len += snprintf(out + len, outSize - len,
+				"attribute %s %sQ;\n#define %s (%sQ * ", type, attrib->name,
+				attrib->name, attrib->name);
+		if (len < outSize) {
+			len += gl_VertexWriteVec(out + len, outSize - len, attrib->size,
+					attrib->scale);
+		}
+		if (len < outSize) {
+			len += snprintf(out + len, outSize - len, " + ");
+		}
+		if (len < outSize) {
+			len += gl_VertexWriteVec(out + len, outSize - len, attrib->size,
+					attrib->bias);
+		}
+		if (len < outSize) {
+			len += snprintf(out + len, outSize - len, ")\n");
+		}
+	}
+	if (len < outSize) {
+		len += snprintf(out + len, outSize - len, "%s", body);
+	}
+	return len < outSize ? GL_TRUE : GL_FALSE;
+}
+
+void gl_VertexFormatLocations(const gl_vertex_format_t *format,
+		GLuint program, GLint *locations) {
+	GLint idx;
+	for (idx = 0; idx < format->count; ++idx) {
+		const gl_vertex_attrib_t *attrib = &format->attribs[idx];
+		GLchar name[GL_VERTEX_NAME_MAX + 1];
+		snprintf(name, sizeof name,
+				gl_VertexAttribIdentity(attrib) ? "%s" : "%sQ", attrib->name);
+		locations[idx] = glGetAttribLocation(program, name);
+	}
+}
+
+void gl_VertexFormatBind(const gl_vertex_format_t *format,
+		const GLint *locations, const GLvoid *data) {
+	GLuint mask = 0;
+	GLint idx;
+	for (idx = 0; idx < format->count; ++idx) {
+		const gl_vertex_attrib_t *attrib = &format->attribs[idx];
+		if (locations[idx] < 0) {
+			continue;
+		}
+		glVertexAttribPointer(locations[idx], attrib->size, attrib->type,
+				attrib->normalized, format->stride,
+				(const GLubyte*) data + attrib->offset);
+		mask |= 1u << locations[idx];
+	}
+	gl_StateVertexAttribArrays(mask);
+}
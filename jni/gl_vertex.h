@@ -0,0 +1,97 @@
+#ifndef GL_VERTEX_H__
+#define GL_VERTEX_H__
+
+#include <GLES2/gl2.h>
+
+// Maximum number of attributes in one vertex format.
+#define GL_VERTEX_ATTRIB_MAX 8
+
+// Maximum length of attribute name.
+#define GL_VERTEX_NAME_MAX 32
+
+/*
+ Description of one quantized attribute. Shader sees value
+ decoded as (stored * scale + bias) per component.
+ */
+typedef struct {
+	GLchar name[GL_VERTEX_NAME_MAX];
+	GLint size;
+	GLenum type;
+	GLboolean normalized;
+	GLint offset;
+	GLfloat scale[4];
+	GLfloat bias[4];
+} gl_vertex_attrib_t;
+
+/*
+ Interleaved vertex format.
+ */
+typedef struct {
+	GLsizei stride;
+	GLint count;
+	gl_vertex_attrib_t attribs[GL_VERTEX_ATTRIB_MAX];
+} gl_vertex_format_t;
+
+/*
+ Initializes empty vertex format with given vertex size.
+ */
+void gl_VertexFormatInit(gl_vertex_format_t *format, GLsizei stride);
+
+/*
+ Adds attribute stored at offset within vertex. Scale and bias, if
+ given, hold size values used for decoding attribute in shader.
+ */
+void gl_VertexFormatAdd(gl_vertex_format_t *format, const GLchar *name,
+		GLint size, GLenum type, GLboolean normalized, GLint offset,
+		const GLfloat *scale, const GLfloat *bias);
+
+/*
+ Writes vertex shader source into out. Attribute declarations matching
+ format are generated and followed by body. Attributes needing decoding
+ are declared with "Q" suffix and body sees decoded value under the
+ original name. Returns GL_FALSE if out is too small.
+ */
+GLboolean gl_VertexFormatShader(const gl_vertex_format_t *format,
+		const GLchar *body, GLchar *out, GLsizei outSize);
+
+/*
+ Looks up locations of format attributes from program
+ generated with gl_VertexFormatShader.
+ */
+void gl_VertexFormatLocations(const gl_vertex_format_t *format,
+		GLuint program, GLint *locations);
+
+/*
+ Sets vertex attribute pointers for vertices starting at data, which
+ is either a client side pointer or offset into bound buffer, and
+ enables exactly the attribute arrays of this format.
+ */
+void gl_VertexFormatBind(const gl_vertex_format_t *format,
+		const GLint *locations, const GLvoid *data);
+
+/*
+ Quantizes value in range [-range, range] into normalized GL_SHORT.
+ */
+static inline GLshort gl_VertexShort(GLfloat value, GLfloat range) {
+	value = value / range * 32767.f;
+	value = value < -32767.f ? -32767.f : value > 32767.f ? 32767.f : value;
+	return (GLshort) (value < 0 ? value - .5f : value + .5f);
+}
+
+/*
+ Quantizes value in range [0, 1] into normalized GL_UNSIGNED_SHORT.
+ */
+static inline GLushort gl_VertexUShort(GLfloat value) {
+	value = value < 0.f ? 0.f : value > 1.f ? 1.f : value;
+	return (GLushort) (value * 65535.f + .5f);
+}
+
+/*
+ Quantizes value in range [0, 1] into normalized GL_UNSIGNED_BYTE.
+ */
+static inline GLubyte gl_VertexUByte(GLfloat value) {
+	value = value < 0.f ? 0.f : value > 1.f ? 1.f : value;
+	return (GLubyte) (value * 255.f + .5f);
+}
+
+#endif
@@ -0,0 +1,386 @@
+/*
+ Copyright 2012 Harri Smtt
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+ */
+
+
+#include <pthread.h>
+#include <semaphore.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#ifdef __ANDROID__
+#include <android/log.h>
+#endif
+#include "log.h"
+
+// Number of records in queue, has to be power of two.
+#define LOG_RING_SIZE 128
+// Maximum number of arguments and bytes of copied strings per record.
+#define LOG_ARGS_MAX 8
+#define LOG_TEXT_SIZE 128
+// Maximum length of formatted message.
+#define LOG_MESSAGE_SIZE 512
+
+// Argument types resolved from conversion specifications.
+typedef enum {
+	LOG_ARG_NONE,
+	LOG_ARG_INT,
+	LOG_ARG_LONG,
+	LOG_ARG_LLONG,
+	LOG_ARG_SIZE,
+	LOG_ARG_DOUBLE,
+	LOG_ARG_PTR,
+	LOG_ARG_STRING
+} log_arg_t;
+
+// Single queued record. Sequence tells which round of ring buffer
+// record belongs to and whether it's been written or read already.
+typedef struct {
+	uint32_t sequence;
+	uint8_t level;
+	uint8_t argCount;
+	uint16_t textSize;
+	const char *tag;
+	const char *fmt;
+	union {
+		int64_t i;
+		double d;
+		const void *p;
+	} args[LOG_ARGS_MAX];
+	char text[LOG_TEXT_SIZE];
+} log_record_t;
+
+#define GLOBALS log_globals
+typedef struct {
+	log_record_t ring[LOG_RING_SIZE];
+	uint32_t writePos;
+	uint32_t readPos;
+	uint32_t dropped;
+	// Set while drain thread waits on wakeup for queue to fill.
+	uint32_t sleeping;
+	sem_t wakeup;
+	pthread_t thread;
+} log_globals_t;
+log_globals_t GLOBALS;
+
+pthread_once_t log_once = PTHREAD_ONCE_INIT;
+
+// Parses conversion specification following '%'. Returns pointer
+// to first character after it and stores argument type.
+const char* log_ParseSpec(const char *fmt, log_arg_t *type) {
+	// Flags, width and precision.
+	while (*fmt && strchr("-+ #0123456789.", *fmt)) {
+		++fmt;
+	}
+	// Length modifier.
+	int longs = 0, size = 0;
+	while (*fmt && strchr("hlzjt", *fmt)) {
+		longs += *fmt == 'l';
+		size |= *fmt == 'z' || *fmt == 't';
+		longs += (*fmt == 'j') * 2;
+		++fmt;
+	}
+	switch (*fmt) {
+	case 'd':
+	case 'i':
+	case 'u':
+	case 'o':
+	case 'x':
+	case 'X':
+		*type = size ? LOG_ARG_SIZE :
+				longs >= 2 ? LOG_ARG_LLONG :
+				longs == 1 ? LOG_ARG_LONG : LOG_ARG_INT;
+		break;
+	case 'c':
+		*type = LOG_ARG_INT;
+		break;
+	case 'e':
+	case 'E':
+	case 'f':
+	case 'F':
+	case 'g':
+	case 'G':
+	case 'a':
+	case 'A':
+		*type = LOG_ARG_DOUBLE;
+		break;
+	case 'p':
+		*type = LOG_ARG_PTR;
+		break;
+	case 's':
+		*type = LOG_ARG_STRING;
+		break;
+	default:
+		*type = LOG_ARG_NONE;
+		break;
+	}
+	return *fmt ? fmt + 1 : fmt;
+}
+
+// Formats record into given buffer one conversion at a time.
+void log_Format(const log_record_t *record, char *out, size_t outSize) {
+	const char *fmt = record->fmt;
+	size_t len = 0;
+	int arg = 0;
+	while (*fmt && len < outSize - 1) {
+		if (*fmt != '%') {
+			out[len++] = *fmt++;
+			continue;
+		}
+		log_arg_t type;
+		const char *end = log_ParseSpec(fmt + 1, &type);
+		char spec[16];
+		size_t specLen = end - fmt;
+		// Copy unknown, overlong and excess specifications as they are.
+		if (type == LOG_ARG_NONE || specLen >= sizeof spec
+				|| arg >= record->argCount) {
+			if (fmt[1] == '%') {
+				out[len++] = '%';
+			} else {
+				size_t copy = specLen < outSize - 1 - len ?
+						specLen : outSize - 1 - len;
+				memcpy(out + len, fmt, copy);
+				len += copy;
+			}
+			fmt = end;
+			continue;
+		}
+		memcpy(spec, fmt, specLen);
+		spec[specLen] = '\0';
+		fmt = end;
+
+		char *dst = out + len;
+		size_t dstSize = outSize - len;
+		int n = 0;
+		switch (type) {
+		case LOG_ARG_INT:
+			n = snprintf(dst, dstSize, spec, (int) record->args[arg].i);
+			break;
+		case LOG_ARG_LONG:
+			n = snprintf(dst, dstSize, spec, (long) record->args[arg].i);
+			break;
+		case LOG_ARG_LLONG:
+			n = snprintf(dst, dstSize, spec, (long long) record->args[arg].i);
+			break;
+		case LOG_ARG_SIZE:
+			n = snprintf(dst, dstSize, spec, (size_t) record->args[arg].i);
+			break;
+		case LOG_ARG_DOUBLE:
+			n = snprintf(dst, dstSize, spec, record->args[arg].d);
+			break;
+		case LOG_ARG_PTR:
+			n = snprintf(dst, dstSize, spec, record->args[arg].p);
+			break;
+		case LOG_ARG_STRING:
+			n = snprintf(dst, dstSize, spec,
+					record->args[arg].i < 0 ?
+							"(null)" : record->text + record->args[arg].i);
+			break;
+		default:
+			break;
+		}
+		++arg;
+		if (n > 0) {
+			len += (size_t) n < dstSize ? (size_t) n : dstSize - 1;
+		}
+	}
+	out[len] = '\0';
+}
+
+// Writes formatted message into system log or stdout.
+void log_Sink(int level, const char *tag, const char *message) {
+#ifdef __ANDROID__
+	__android_log_write(level, tag, message);
+#else
+	fprintf(stdout, "%c/%s: %s\n", "VDIWE"[level - LOG_LEVEL_VERBOSE], tag,
+			message);
+	fflush(stdout);
+#endif
+}
+
+// Writes out all published records. Returns number of records written.
+int log_Drain() {
+	char message[LOG_MESSAGE_SIZE];
+	int count = 0;
+	for (;;) {
+		uint32_t pos = GLOBALS.readPos;
+		log_record_t *record = &GLOBALS.ring[pos & (LOG_RING_SIZE - 1)];
+		// Sequentially consistent, pairs with log_Write when
+		// drain thread is about to sleep.
+		uint32_t sequence = __atomic_load_n(&record->sequence,
+				__ATOMIC_SEQ_CST);
+		if (sequence != pos + 1) {
+			break;
+		}
+		log_Format(record, message, sizeof message);
+		log_Sink(record->level, record->tag, message);
+		// Hand record back to writers for next round.
+		__atomic_store_n(&record->sequence, pos + LOG_RING_SIZE,
+				__ATOMIC_RELEASE);
+		__atomic_store_n(&GLOBALS.readPos, pos + 1, __ATOMIC_RELEASE);
+		++count;
+	}
+	uint32_t dropped = __atomic_exchange_n(&GLOBALS.dropped, 0,
+			__ATOMIC_RELAXED);
+	if (dropped) {
+		snprintf(message, sizeof message, "%u records dropped", dropped);
+		log_Sink(LOG_LEVEL_WARN, "log_Drain", message);
+	}
+	return count;
+}
+
+// Background thread function doing formatting and writing. Blocks
+// once queue is empty until a writer publishes next record.
+void* log_Thread(void *startParams) {
+	(void) startParams;
+	for (;;) {
+		if (log_Drain() > 0) {
+			continue;
+		}
+		// Announce sleeping before checking queue once more, writer
+		// publishing in between either sees the flag or gets drained.
+		__atomic_store_n(&GLOBALS.sleeping, 1, __ATOMIC_SEQ_CST);
+		if (log_Drain() > 0) {
+			__atomic_store_n(&GLOBALS.sleeping, 0, __ATOMIC_RELAXED);
+			continue;
+		}
+		while (sem_wait(&GLOBALS.wakeup) != 0) {
+		}
+	}
+	return NULL;
+}
+
+// Initializes ring buffer and starts drain thread.
+void log_Init() {
+	uint32_t idx;
+	for (idx = 0; idx < LOG_RING_SIZE; ++idx) {
+		GLOBALS.ring[idx].sequence = idx;
+	}
+	sem_init(&GLOBALS.wakeup, 0, 0);
+	pthread_attr_t attr;
+	pthread_attr_init(&attr);
+	pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+	pthread_create(&GLOBALS.thread, &attr, log_Thread, NULL);
+	pthread_attr_destroy(&attr);
+#ifndef __ANDROID__
+	// Host processes exit normally, don't lose their last records.
+	atexit(log_Flush);
+#endif
+}
+
+void log_Write(int level, const char *tag, const char *fmt, ...) {
+	pthread_once(&log_once, log_Init);
+
+	// Claim next free record, there may be other writers racing for it.
+	uint32_t pos = __atomic_load_n(&GLOBALS.writePos, __ATOMIC_RELAXED);
+	log_record_t *record;
+	for (;;) {
+		record = &GLOBALS.ring[pos & (LOG_RING_SIZE - 1)];
+		uint32_t sequence = __atomic_load_n(&record->sequence,
+				__ATOMIC_ACQUIRE);
+		int32_t diff = (int32_t) (sequence - pos);
+		if (diff == 0) {
+			if (__atomic_compare_exchange_n(&GLOBALS.writePos, &pos, pos + 1,
+					1, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+				break;
+			}
+		} else if (diff < 0) {
+			// Queue is full, drop record instead of blocking caller.
+			__atomic_add_fetch(&GLOBALS.dropped, 1, __ATOMIC_RELAXED);
+			return;
+		} else {
+			pos = __atomic_load_n(&GLOBALS.writePos, __ATOMIC_RELAXED);
+		}
+	}
+
+	record->level = level;
+	record->tag = tag;
+	record->fmt = fmt;
+	record->argCount = 0;
+	record->textSize = 0;
+
+	// Copy arguments as raw values, types come from format string.
+	va_list ap;
+	va_start(ap, fmt);
+	while (*fmt && record->argCount < LOG_ARGS_MAX) {
+		if (*fmt++ != '%') {
+			continue;
+		}
+		log_arg_t type;
+		fmt = log_ParseSpec(fmt, &type);
+		int64_t *value = &record->args[record->argCount].i;
+		switch (type) {
+		case LOG_ARG_INT:
+			*value = va_arg(ap, int);
+			break;
+		case LOG_ARG_LONG:
+			*value = va_arg(ap, long);
+			break;
+		case LOG_ARG_LLONG:
+			*value = va_arg(ap, long long);
+			break;
+		case LOG_ARG_SIZE:
+			*value = va_arg(ap, size_t);
+			break;
+		case LOG_ARG_DOUBLE:
+			record->args[record->argCount].d = va_arg(ap, double);
+			break;
+		case LOG_ARG_PTR:
+			record->args[record->argCount].p = va_arg(ap, void*);
+			break;
+		case LOG_ARG_STRING: {
+			// Strings are truncated to fit into record, ones which
+			// don't fit at all are written out as null.
+			const char *str = va_arg(ap, const char*);
+			size_t left = LOG_TEXT_SIZE - record->textSize;
+			*value = -1;
+			if (str && left > 0) {
+				size_t len = strnlen(str, left - 1);
+				*value = record->textSize;
+				memcpy(record->text + record->textSize, str, len);
+				record->text[record->textSize + len] = '\0';
+				record->textSize += len + 1;
+			}
+			break;
+		}
+		default:
+			continue;
+		}
+		++record->argCount;
+	}
+	va_end(ap);
+
+	// Publish record for drain thread and wake it up if it went to
+	// sleep on empty queue. Only the writer clearing the flag posts,
+	// sem_post doesn't take locks.
+	__atomic_store_n(&record->sequence, pos + 1, __ATOMIC_SEQ_CST);
+	if (__atomic_load_n(&GLOBALS.sleeping, __ATOMIC_SEQ_CST)
+			&& __atomic_exchange_n(&GLOBALS.sleeping, 0, __ATOMIC_RELAXED)) {
+		sem_post(&GLOBALS.wakeup);
+	}
+}
+
+void log_Flush() {
+	uint32_t pos = __atomic_load_n(&GLOBALS.writePos, __ATOMIC_ACQUIRE);
+	struct timespec sleep = { 0, 1000000 };
+	while ((int32_t) (__atomic_load_n(&GLOBALS.readPos, __ATOMIC_ACQUIRE)
+			- pos) < 0) {
+		nanosleep(&sleep, NULL);
+	}
+}
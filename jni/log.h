@@ -14,15 +14,73 @@
  limitations under the License.
  */
 
+
 #ifndef LOG_H__
 #define LOG_H__
 
-// TODO: It may be best to use some debug flag instead.
-#if 1
-#include <android/log.h>
-#define LOGD(tag, ...) __android_log_print(ANDROID_LOG_DEBUG, tag, __VA_ARGS__)
+/*
+ Log levels, values match with Android log priorities.
+ */
+#define LOG_LEVEL_VERBOSE  2
+#define LOG_LEVEL_DEBUG    3
+#define LOG_LEVEL_INFO     4
+#define LOG_LEVEL_WARN     5
+#define LOG_LEVEL_ERROR    6
+#define LOG_LEVEL_NONE     7
+
+/*
+ Lowest level compiled in. Calls below it are removed by preprocessor,
+ their arguments aren't even evaluated.
+ */
+#ifndef LOG_LEVEL
+#define LOG_LEVEL LOG_LEVEL_DEBUG
+#endif
+
+/*
+ Queues log record without formatting it. Format string is parsed only
+ for copying arguments, actual formatting and writing into system log
+ (or stdout on host) is done later on a background thread. Never blocks,
+ records are dropped if queue is full.
+
+ Tag and format have to be string literals, string arguments are copied.
+ Supports printf conversions except for '*' width and 'L' modifier.
+ */
+void log_Write(int level, const char *tag, const char *fmt, ...)
+		__attribute__ ((format (printf, 3, 4)));
+
+/*
+ Waits until all records queued so far have been written.
+ */
+void log_Flush();
+
+#if LOG_LEVEL <= LOG_LEVEL_VERBOSE
+#define LOGV(tag, ...) log_Write(LOG_LEVEL_VERBOSE, tag, __VA_ARGS__)
+#else
+#define LOGV(...)
+#endif
+
+#if LOG_LEVEL <= LOG_LEVEL_DEBUG
+#define LOGD(tag, ...) log_Write(LOG_LEVEL_DEBUG, tag, __VA_ARGS__)
 #else
 #define LOGD(...)
 #endif
 
+#if LOG_LEVEL <= LOG_LEVEL_INFO
+#define LOGI(tag, ...) log_Write(LOG_LEVEL_INFO, tag, __VA_ARGS__)
+#else
+#define LOGI(...)
+#endif
+
+#if LOG_LEVEL <= LOG_LEVEL_WARN
+#define LOGW(tag, ...) log_Write(LOG_LEVEL_WARN, tag, __VA_ARGS__)
+#else
+#define LOGW(...)
+#endif
+
+#if LOG_LEVEL <= LOG_LEVEL_ERROR
+#define LOGE(tag, ...) log_Write(LOG_LEVEL_ERROR, tag, __VA_ARGS__)
+#else
+#define LOGE(...)
+#endif
+
 #endif
@@ -38,8 +38,9 @@ public final class FlowerService extends WallpaperService {
 	 * Connects to underlying rendering thread. This method should be called
 	 * only once when class is created. And there should be same amount of calls
 	 * to flowersDisconnects to enable rendering thread to be destroyed.
+	 * Scene is restored from and saved into given files directory.
 	 */
-	public native void flowersConnect();
+	public native void flowersConnect(String filesDir);
 
 	/**
 	 * Disconnects from rendering thread. Once there are no more connections
@@ -67,6 +68,13 @@ public final class FlowerService extends WallpaperService {
 	 */
 	public native void flowersSetSurfaceSize(int width, int height);
 
+	/**
+	 * Sets color scheme and colors as packed ARGB values. Colors are used only
+	 * if scheme is custom one, predefined schemes override them.
+	 */
+	public native void flowersSetColors(int scheme, int flower1, int flower2,
+			int bgTop, int bgBottom);
+
 	@Override
 	public Engine onCreateEngine() {
 		return new WallpaperEngine();
@@ -95,7 +103,8 @@ public final class FlowerService extends WallpaperService {
 					.getDefaultSharedPreferences(FlowerService.this);
 			mPreferences.registerOnSharedPreferenceChangeListener(this);
 
-			flowersConnect();
+			flowersConnect(getFilesDir().getAbsolutePath());
+			updateColors();
 		}
 
 		@Override
@@ -117,6 +126,7 @@ public final class FlowerService extends WallpaperService {
 		@Override
 		public void onSharedPreferenceChanged(
 				SharedPreferences sharedPreferences, String key) {
+			updateColors();
 		}
 
 		@Override
@@ -141,6 +151,24 @@ public final class FlowerService extends WallpaperService {
 			flowersSetSurface(null);
 		}
 
+		/**
+		 * Passes color preferences to native side. Defaults match with the
+		 * ones in preferences.xml.
+		 */
+		private void updateColors() {
+			int scheme = Integer.parseInt(mPreferences.getString(
+					getString(R.string.key_colors_scheme), "1"));
+			int flower1 = mPreferences.getInt(
+					getString(R.string.key_colors_flower_1), 0x80AA8060);
+			int flower2 = mPreferences.getInt(
+					getString(R.string.key_colors_flower_2), 0x80AA80A0);
+			int bgTop = mPreferences.getInt(
+					getString(R.string.key_colors_bg_top), 0xFF808080);
+			int bgBottom = mPreferences.getInt(
+					getString(R.string.key_colors_bg_bottom), 0xFFAA8060);
+			flowersSetColors(scheme, flower1, flower2, bgTop, bgBottom);
+		}
+
 		@Override
 		public void onVisibilityChanged(boolean visible) {
 			super.onVisibilityChanged(visible);
@@ -0,0 +1,536 @@
+/*
+ Copyright 2012 Harri Smtt
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+ */
+
+/*
+ Host side replayer for GL command streams recorded with a GL_CAPTURE
+ build of libflowers-jni. Stream is executed against an offscreen EGL
+ pbuffer and timing is collected per command type and per frame.
+
+ Build and run on a Linux host with:
+   gcc -O2 -o gl_replay tools/gl_replay.c -lEGL -lGLESv2
+   ./gl_replay capture.glcap [width height]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <EGL/egl.h>
+#include <GLES2/gl2.h>
+#include "../jni/gl_capture.h"
+
+// Printable names for gl_capture_op_t values.
+static const char *replay_opNames[GL_CAPTURE_OP_COUNT] = {
+		[GL_CAPTURE_OP_FRAME_END] = "FrameEnd",
+		[GL_CAPTURE_OP_VIEWPORT] = "Viewport",
+		[GL_CAPTURE_OP_CLEAR] = "Clear",
+		[GL_CAPTURE_OP_CLEAR_COLOR] = "ClearColor",
+		[GL_CAPTURE_OP_ENABLE] = "Enable",
+		[GL_CAPTURE_OP_DISABLE] = "Disable",
+		[GL_CAPTURE_OP_BLEND_FUNC] = "BlendFunc",
+		[GL_CAPTURE_OP_PIXEL_STOREI] = "PixelStorei",
+		[GL_CAPTURE_OP_CREATE_SHADER] = "CreateShader",
+		[GL_CAPTURE_OP_SHADER_SOURCE] = "ShaderSource",
+		[GL_CAPTURE_OP_COMPILE_SHADER] = "CompileShader",
+		[GL_CAPTURE_OP_DELETE_SHADER] = "DeleteShader",
+		[GL_CAPTURE_OP_CREATE_PROGRAM] = "CreateProgram",
+		[GL_CAPTURE_OP_ATTACH_SHADER] = "AttachShader",
+		[GL_CAPTURE_OP_LINK_PROGRAM] = "LinkProgram",
+		[GL_CAPTURE_OP_DELETE_PROGRAM] = "DeleteProgram",
+		[GL_CAPTURE_OP_USE_PROGRAM] = "UseProgram",
+		[GL_CAPTURE_OP_GET_UNIFORM_LOCATION] = "GetUniformLocation",
+		[GL_CAPTURE_OP_GET_ATTRIB_LOCATION] = "GetAttribLocation",
+		[GL_CAPTURE_OP_UNIFORM1I] = "Uniform1i",
+		[GL_CAPTURE_OP_UNIFORM1F] = "Uniform1f",
+		[GL_CAPTURE_OP_UNIFORM2F] = "Uniform2f",
+		[GL_CAPTURE_OP_UNIFORM4F] = "Uniform4f",
+		[GL_CAPTURE_OP_ENABLE_ATTRIB] = "EnableVertexAttribArray",
+		[GL_CAPTURE_OP_DISABLE_ATTRIB] = "DisableVertexAttribArray",
+		[GL_CAPTURE_OP_ATTRIB_POINTER] = "VertexAttribPointer",
+		[GL_CAPTURE_OP_ATTRIB_DATA] = "VertexAttribPointer(client)",
+		[GL_CAPTURE_OP_DRAW_ARRAYS] = "DrawArrays",
+		[GL_CAPTURE_OP_DRAW_ELEMENTS] = "DrawElements",
+		[GL_CAPTURE_OP_DRAW_ELEMENTS_DATA] = "DrawElements(client)",
+		[GL_CAPTURE_OP_GEN_BUFFER] = "GenBuffers",
+		[GL_CAPTURE_OP_DELETE_BUFFER] = "DeleteBuffers",
+		[GL_CAPTURE_OP_BIND_BUFFER] = "BindBuffer",
+		[GL_CAPTURE_OP_BUFFER_DATA] = "BufferData",
+		[GL_CAPTURE_OP_BUFFER_SUB_DATA] = "BufferSubData",
+		[GL_CAPTURE_OP_GEN_TEXTURE] = "GenTextures",
+		[GL_CAPTURE_OP_DELETE_TEXTURE] = "DeleteTextures",
+		[GL_CAPTURE_OP_ACTIVE_TEXTURE] = "ActiveTexture",
+		[GL_CAPTURE_OP_BIND_TEXTURE] = "BindTexture",
+		[GL_CAPTURE_OP_TEX_PARAMETERI] = "TexParameteri",
+		[GL_CAPTURE_OP_TEX_IMAGE_2D] = "TexImage2D",
+		[GL_CAPTURE_OP_TEX_SUB_IMAGE_2D] = "TexSubImage2D" };
+
+// Mapping from recorded object name or location to replayed one.
+// Locations are scoped with recorded program name, kind separates
+// uniforms, attributes and different object types.
+typedef struct {
+	GLuint kind;
+	GLuint scope;
+	GLuint from;
+	GLuint to;
+} replay_map_t;
+
+#define REPLAY_KIND_OBJECT   0
+#define REPLAY_KIND_BUFFER   1
+#define REPLAY_KIND_TEXTURE  2
+#define REPLAY_KIND_UNIFORM  3
+#define REPLAY_KIND_ATTRIB   4
+
+// Timing statistics for one command type.
+typedef struct {
+	unsigned long count;
+	unsigned long long totalNs;
+	unsigned long long maxNs;
+} replay_stats_t;
+
+#define GLOBALS replay_globals
+typedef struct {
+	const unsigned char *start;
+	const unsigned char *ptr;
+	const unsigned char *end;
+	replay_map_t *maps;
+	int mapCount;
+	int mapSize;
+	GLuint program;
+	replay_stats_t ops[GL_CAPTURE_OP_COUNT];
+	replay_stats_t frames;
+} replay_globals_t;
+replay_globals_t GLOBALS;
+
+unsigned long long replay_TimeNanos() {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+void replay_StatsAdd(replay_stats_t *stats, unsigned long long ns) {
+	++stats->count;
+	stats->totalNs += ns;
+	if (ns > stats->maxNs) {
+		stats->maxNs = ns;
+	}
+}
+
+GLuint replay_Word() {
+	GLuint value = 0;
+	if (GLOBALS.ptr + sizeof value <= GLOBALS.end) {
+		memcpy(&value, GLOBALS.ptr, sizeof value);
+	}
+	GLOBALS.ptr += sizeof value;
+	return value;
+}
+
+GLfloat replay_Float() {
+	GLuint value = replay_Word();
+	GLfloat ret;
+	memcpy(&ret, &value, sizeof ret);
+	return ret;
+}
+
+// Returns pointer to blob data within stream and stores its size.
+const GLvoid* replay_Blob(GLuint *size) {
+	*size = replay_Word();
+	const GLvoid *data = GLOBALS.ptr;
+	GLOBALS.ptr += *size;
+	return *size > 0 && GLOBALS.ptr <= GLOBALS.end ? data : NULL;
+}
+
+void replay_MapAdd(GLuint kind, GLuint scope, GLuint from, GLuint to) {
+	if (GLOBALS.mapCount == GLOBALS.mapSize) {
+		GLOBALS.mapSize = GLOBALS.mapSize ? GLOBALS.mapSize * 2 : 64;
+		GLOBALS.maps = realloc(GLOBALS.maps,
+				GLOBALS.mapSize * sizeof(replay_map_t));
+	}
+	replay_map_t map = { kind, scope, from, to };
+	GLOBALS.maps[GLOBALS.mapCount++] = map;
+}
+
+// Returns replayed value for recorded one. Latest mapping wins since
+// names are reused once deleted. Unknown values are passed as is.
+GLuint replay_Map(GLuint kind, GLuint scope, GLuint from) {
+	int idx;
+	for (idx = GLOBALS.mapCount - 1; idx >= 0; --idx) {
+		replay_map_t *map = &GLOBALS.maps[idx];
+		if (map->kind == kind && map->scope == scope && map->from == from) {
+			return map->to;
+		}
+	}
+	return from;
+}
+
+#define OBJECT(name) replay_Map(REPLAY_KIND_OBJECT, 0, name)
+#define UNIFORM(location) replay_Map(REPLAY_KIND_UNIFORM, GLOBALS.program, location)
+#define ATTRIB(index) replay_Map(REPLAY_KIND_ATTRIB, GLOBALS.program, index)
+
+// Executes one command. Returns opcode or 0 on end of stream.
+int replay_Command() {
+	if (GLOBALS.ptr >= GLOBALS.end) {
+		return 0;
+	}
+	int op = *GLOBALS.ptr++;
+	GLuint a0, a1, a2, a3, a4, a5, a6, size;
+	GLfloat f0, f1, f2, f3;
+	const GLvoid *data;
+
+	switch (op) {
+	case GL_CAPTURE_OP_FRAME_END:
+		glFinish();
+		break;
+	case GL_CAPTURE_OP_VIEWPORT:
+		a0 = replay_Word();
+		a1 = replay_Word();
+		a2 = replay_Word();
+		a3 = replay_Word();
+		glViewport(a0, a1, a2, a3);
+		break;
+	case GL_CAPTURE_OP_CLEAR:
+		glClear(replay_Word());
+		break;
+	case GL_CAPTURE_OP_CLEAR_COLOR:
+		f0 = replay_Float();
+		f1 = replay_Float();
+		f2 = replay_Float();
+		f3 = replay_Float();
+		glClearColor(f0, f1, f2, f3);
+		break;
+	case GL_CAPTURE_OP_ENABLE:
+		glEnable(replay_Word());
+		break;
+	case GL_CAPTURE_OP_DISABLE:
+		glDisable(replay_Word());
+		break;
+	case GL_CAPTURE_OP_BLEND_FUNC:
+		a0 = replay_Word();
+		a1 = replay_Word();
+		glBlendFunc(a0, a1);
+		break;
+	case GL_CAPTURE_OP_PIXEL_STOREI:
+		a0 = replay_Word();
+		a1 = replay_Word();
+		glPixelStorei(a0, a1);
+		break;
+	case GL_CAPTURE_OP_CREATE_SHADER:
+		a0 = replay_Word();
+		a1 = replay_Word();
+		replay_MapAdd(REPLAY_KIND_OBJECT, 0, a1, glCreateShader(a0));
+		break;
+	case GL_CAPTURE_OP_SHADER_SOURCE: {
+		a0 = replay_Word();
+		data = replay_Blob(&size);
+		const GLchar *source = data ? data : "";
+		GLint length = size;
+		glShaderSource(OBJECT(a0), 1, &source, &length);
+		break;
+	}
+	case GL_CAPTURE_OP_COMPILE_SHADER:
+		glCompileShader(OBJECT(replay_Word()));
+		break;
+	case GL_CAPTURE_OP_DELETE_SHADER:
+		glDeleteShader(OBJECT(replay_Word()));
+		break;
+	case GL_CAPTURE_OP_CREATE_PROGRAM:
+		a0 = replay_Word();
+		replay_MapAdd(REPLAY_KIND_OBJECT, 0, a0, glCreateProgram());
+		break;
+	case GL_CAPTURE_OP_ATTACH_SHADER:
+		a0 = replay_Word();
+		a1 = replay_Word();
+		glAttachShader(OBJECT(a0), OBJECT(a1));
+		break;
+	case GL_CAPTURE_OP_LINK_PROGRAM:
+		glLinkProgram(OBJECT(replay_Word()));
+		break;
+	case GL_CAPTURE_OP_DELETE_PROGRAM:
+		glDeleteProgram(OBJECT(replay_Word()));
+		break;
+	case GL_CAPTURE_OP_USE_PROGRAM:
+		GLOBALS.program = replay_Word();
+		glUseProgram(OBJECT(GLOBALS.program));
+		break;
+	case GL_CAPTURE_OP_GET_UNIFORM_LOCATION:
+	case GL_CAPTURE_OP_GET_ATTRIB_LOCATION: {
+		a0 = replay_Word();
+		a1 = replay_Word();
+		data = replay_Blob(&size);
+		char name[256];
+		size = size < sizeof name ? size : sizeof name - 1;
+		memcpy(name, data ? data : "", size);
+		name[size] = 0;
+		if (op == GL_CAPTURE_OP_GET_UNIFORM_LOCATION) {
+			replay_MapAdd(REPLAY_KIND_UNIFORM, a0, a1,
+					glGetUniformLocation(OBJECT(a0), name));
+		} else {
+			replay_MapAdd(REPLAY_KIND_ATTRIB, a0, a1,
+					glGetAttribLocation(OBJECT(a0), name));
+		}
+		break;
+	}
+	case GL_CAPTURE_OP_UNIFORM1I:
+		a0 = replay_Word();
+		a1 = replay_Word();
+		glUniform1i(UNIFORM(a0), a1);
+		break;
+	case GL_CAPTURE_OP_UNIFORM1F:
+		a0 = replay_Word();
+		glUniform1f(UNIFORM(a0), replay_Float());
+		break;
+	case GL_CAPTURE_OP_UNIFORM2F:
+		a0 = replay_Word();
+		f0 = replay_Float();
+		f1 = replay_Float();
+		glUniform2f(UNIFORM(a0), f0, f1);
+		break;
+	case GL_CAPTURE_OP_UNIFORM4F:
+		a0 = replay_Word();
+		f0 = replay_Float();
+		f1 = replay_Float();
+		f2 = replay_Float();
+		f3 = replay_Float();
+		glUniform4f(UNIFORM(a0), f0, f1, f2, f3);
+		break;
+	case GL_CAPTURE_OP_ENABLE_ATTRIB:
+		glEnableVertexAttribArray(ATTRIB(replay_Word()));
+		break;
+	case GL_CAPTURE_OP_DISABLE_ATTRIB:
+		glDisableVertexAttribArray(ATTRIB(replay_Word()));
+		break;
+	case GL_CAPTURE_OP_ATTRIB_POINTER:
+	case GL_CAPTURE_OP_ATTRIB_DATA:
+		a0 = replay_Word();
+		a1 = replay_Word();
+		a2 = replay_Word();
+		a3 = replay_Word();
+		a4 = replay_Word();
+		if (op == GL_CAPTURE_OP_ATTRIB_POINTER) {
+			data = (const GLvoid*) (size_t) replay_Word();
+		} else {
+			data = replay_Blob(&size);
+		}
+		glVertexAttribPointer(ATTRIB(a0), a1, a2, a3, a4, data);
+		break;
+	case GL_CAPTURE_OP_DRAW_ARRAYS:
+		a0 = replay_Word();
+		a1 = replay_Word();
+		a2 = replay_Word();
+		glDrawArrays(a0, a1, a2);
+		break;
+	case GL_CAPTURE_OP_DRAW_ELEMENTS:
+	case GL_CAPTURE_OP_DRAW_ELEMENTS_DATA:
+		a0 = replay_Word();
+		a1 = replay_Word();
+		a2 = replay_Word();
+		if (op == GL_CAPTURE_OP_DRAW_ELEMENTS) {
+			data = (const GLvoid*) (size_t) replay_Word();
+		} else {
+			data = replay_Blob(&size);
+		}
+		glDrawElements(a0, a1, a2, data);
+		break;
+	case GL_CAPTURE_OP_GEN_BUFFER:
+		a0 = replay_Word();
+		glGenBuffers(1, &a1);
+		replay_MapAdd(REPLAY_KIND_BUFFER, 0, a0, a1);
+		break;
+	case GL_CAPTURE_OP_DELETE_BUFFER:
+		a0 = replay_Map(REPLAY_KIND_BUFFER, 0, replay_Word());
+		glDeleteBuffers(1, &a0);
+		break;
+	case GL_CAPTURE_OP_BIND_BUFFER:
+		a0 = replay_Word();
+		a1 = replay_Word();
+		glBindBuffer(a0, a1 ? replay_Map(REPLAY_KIND_BUFFER, 0, a1) : 0);
+		break;
+	case GL_CAPTURE_OP_BUFFER_DATA:
+		a0 = replay_Word();
+		a1 = replay_Word();
+		a2 = replay_Word();
+		data = replay_Blob(&size);
+		glBufferData(a0, a2, data, a1);
+		break;
+	case GL_CAPTURE_OP_BUFFER_SUB_DATA:
+		a0 = replay_Word();
+		a1 = replay_Word();
+		data = replay_Blob(&size);
+		glBufferSubData(a0, a1, size, data);
+		break;
+	case GL_CAPTURE_OP_GEN_TEXTURE:
+		a0 = replay_Word();
+		glGenTextures(1, &a1);
+		replay_MapAdd(REPLAY_KIND_TEXTURE, 0, a0, a1);
+		break;
+	case GL_CAPTURE_OP_DELETE_TEXTURE:
+		a0 = replay_Map(REPLAY_KIND_TEXTURE, 0, replay_Word());
+		glDeleteTextures(1, &a0);
+		break;
+	case GL_CAPTURE_OP_ACTIVE_TEXTURE:
+		glActiveTexture(replay_Word());
+		break;
+	case GL_CAPTURE_OP_BIND_TEXTURE:
+		a0 = replay_Word();
+		a1 = replay_Word();
+		glBindTexture(a0, a1 ? replay_Map(REPLAY_KIND_TEXTURE, 0, a1) : 0);
+		break;
+	case GL_CAPTURE_OP_TEX_PARAMETERI:
+		a0 = replay_Word();
+		a1 = replay_Word();
+		a2 = replay_Word();
+		glTexParameteri(a0, a1, a2);
+		break;
+	case GL_CAPTURE_OP_TEX_IMAGE_2D:
+		a0 = replay_Word();
+		a1 = replay_Word();
+		a2 = replay_Word();
+		a3 = replay_Word();
+		a4 = replay_Word();
+		a5 = replay_Word();
+		a6 = replay_Word();
+		data = replay_Blob(&size);
+		glTexImage2D(a0, a1, a2, a3, a4, 0, a5, a6, data);
+		break;
+	case GL_CAPTURE_OP_TEX_SUB_IMAGE_2D: {
+		a0 = replay_Word();
+		a1 = replay_Word();
+		a2 = replay_Word();
+		a3 = replay_Word();
+		a4 = replay_Word();
+		a5 = replay_Word();
+		a6 = replay_Word();
+		GLuint type = replay_Word();
+		data = replay_Blob(&size);
+		glTexSubImage2D(a0, a1, a2, a3, a4, a5, a6, type, data);
+		break;
+	}
+	default:
+		fprintf(stderr, "unknown opcode %d at offset %ld\n", op,
+				(long) (GLOBALS.ptr - 1 - GLOBALS.start));
+		GLOBALS.ptr = GLOBALS.end;
+		return 0;
+	}
+	return op;
+}
+
+// Creates offscreen GLES2 context of given size.
+int replay_ContextCreate(int width, int height) {
+	EGLDisplay display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+	if (display == EGL_NO_DISPLAY || !eglInitialize(display, NULL, NULL)) {
+		fprintf(stderr, "eglInitialize failed\n");
+		return 0;
+	}
+	EGLint configAttrs[] = { EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+			EGL_RENDERABLE_TYPE, EGL_OPENGL_ES2_BIT, EGL_RED_SIZE, 8,
+			EGL_GREEN_SIZE, 8, EGL_BLUE_SIZE, 8, EGL_NONE };
+	EGLConfig config;
+	EGLint numConfigs;
+	if (!eglChooseConfig(display, configAttrs, &config, 1, &numConfigs)
+			|| numConfigs < 1) {
+		fprintf(stderr, "eglChooseConfig failed\n");
+		return 0;
+	}
+	EGLint surfaceAttrs[] = { EGL_WIDTH, width, EGL_HEIGHT, height, EGL_NONE };
+	EGLSurface surface = eglCreatePbufferSurface(display, config, surfaceAttrs);
+	EGLint contextAttrs[] = { EGL_CONTEXT_CLIENT_VERSION, 2, EGL_NONE };
+	eglBindAPI(EGL_OPENGL_ES_API);
+	EGLContext context = eglCreateContext(display, config, EGL_NO_CONTEXT,
+			contextAttrs);
+	if (surface == EGL_NO_SURFACE || context == EGL_NO_CONTEXT
+			|| !eglMakeCurrent(display, surface, surface, context)) {
+		fprintf(stderr, "EGL context creation failed\n");
+		return 0;
+	}
+	printf("GL_RENDERER: %s\n", glGetString(GL_RENDERER));
+	return 1;
+}
+
+void replay_PrintStats(const char *name, replay_stats_t *stats) {
+	if (stats->count > 0) {
+		printf("%-28s %8lu %12.3f %12.3f %12.3f\n", name, stats->count,
+				stats->totalNs / 1000000.0,
+				stats->totalNs / 1000.0 / stats->count, stats->maxNs / 1000.0);
+	}
+}
+
+int main(int argc, char **argv) {
+	if (argc < 2) {
+		fprintf(stderr, "usage: %s capture.glcap [width height]\n", argv[0]);
+		return 1;
+	}
+	int width = argc > 3 ? atoi(argv[2]) : 720;
+	int height = argc > 3 ? atoi(argv[3]) : 1280;
+
+	// Read whole stream into memory. Client side vertex and index data
+	// is then referenced directly from it while replaying.
+	FILE *file = fopen(argv[1], "rb");
+	if (file == NULL) {
+		fprintf(stderr, "can't open %s\n", argv[1]);
+		return 1;
+	}
+	fseek(file, 0, SEEK_END);
+	long fileSize = ftell(file);
+	fseek(file, 0, SEEK_SET);
+	unsigned char *stream = malloc(fileSize);
+	if (stream == NULL || fread(stream, 1, fileSize, file) != (size_t) fileSize) {
+		fprintf(stderr, "can't read %s\n", argv[1]);
+		return 1;
+	}
+	fclose(file);
+
+	GLOBALS.start = GLOBALS.ptr = stream;
+	GLOBALS.end = stream + fileSize;
+	if (replay_Word() != GL_CAPTURE_MAGIC) {
+		fprintf(stderr, "%s is not a capture file\n", argv[1]);
+		return 1;
+	}
+	GLuint version = replay_Word();
+	if (version != GL_CAPTURE_VERSION) {
+		fprintf(stderr, "unsupported capture version %u\n", version);
+		return 1;
+	}
+
+	if (!replay_ContextCreate(width, height)) {
+		return 1;
+	}
+
+	unsigned long long frameStart = replay_TimeNanos();
+	for (;;) {
+		unsigned long long start = replay_TimeNanos();
+		int op = replay_Command();
+		if (op == 0) {
+			break;
+		}
+		unsigned long long end = replay_TimeNanos();
+		replay_StatsAdd(&GLOBALS.ops[op], end - start);
+		if (op == GL_CAPTURE_OP_FRAME_END) {
+			replay_StatsAdd(&GLOBALS.frames, end - frameStart);
+			frameStart = end;
+		}
+	}
+
+	printf("%-28s %8s %12s %12s %12s\n", "command", "count", "total ms",
+			"avg us", "max us");
+	int op;
+	for (op = 1; op < GL_CAPTURE_OP_COUNT; ++op) {
+		replay_PrintStats(replay_opNames[op], &GLOBALS.ops[op]);
+	}
+	replay_PrintStats("frame", &GLOBALS.frames);
+
+	free(GLOBALS.maps);
+	free(stream);
+	return 0;
+}
@@ -0,0 +1,493 @@
+/*
+ Copyright 2012 Harri Smtt
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+ */
+
+/*
+ Host side stress test for gl_thread and JNI entry points. flowers_main.c
+ is compiled in against stub EGL and ANativeWindow backends and its JNI
+ functions are called from several threads at once, connecting and
+ disconnecting hosts, pausing, swapping surfaces and resizing them.
+ Afterwards every native window taken from a surface has to be released
+ and every EGL display, context and surface destroyed. A watchdog aborts
+ the run if worker threads stop making progress. Entry point latency
+ histograms are printed at the end.
+
+ Build and run on a Linux host with:
+   gcc -std=gnu99 -O1 -g -fsanitize=thread -DLOG_LEVEL=LOG_LEVEL_ERROR \
+       -DEGL_NO_PLATFORM_SPECIFIC_TYPES -Itools/stub -Ijni \
+       -o gl_thread_stress tools/gl_thread_stress.c jni/gl_thread.c \
+       jni/flowers_clock.c jni/log.c -lpthread
+   ./gl_thread_stress [threads iterations]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+#include "../jni/flowers_main.c"
+
+// Default number of worker threads and calls made by each of them.
+#define STRESS_THREADS     8
+#define STRESS_ITERATIONS  4000
+
+// Seconds without any worker progress before run is considered deadlocked.
+#define STRESS_WATCHDOG_SECONDS 10
+
+// Simulated eglSwapBuffers duration.
+#define STRESS_SWAP_NANOS 200000
+
+// Markers for detecting released or unknown native windows.
+#define STRESS_WINDOW_ALIVE 0x414c4956
+#define STRESS_WINDOW_DEAD  0x44454144
+
+// EGL and ANativeWindow objects tracked by stubs.
+typedef enum {
+	STRESS_OBJECT_WINDOW,
+	STRESS_OBJECT_DISPLAY,
+	STRESS_OBJECT_CONTEXT,
+	STRESS_OBJECT_PBUFFER,
+	STRESS_OBJECT_WINDOW_SURFACE,
+	STRESS_OBJECT_COUNT
+} stress_object_t;
+
+static const char *stress_objectNames[STRESS_OBJECT_COUNT] = { "window",
+		"display", "context", "pbuffer", "windowSurface" };
+
+// Stub native window, leaked on purpose so that double release
+// can be detected instead of touching freed memory.
+struct ANativeWindow {
+	int magic;
+};
+
+// Worker thread arguments.
+typedef struct {
+	unsigned int seed;
+	int iterations;
+} stress_worker_t;
+
+// Global variables struct.
+#define GLOBALS stress_globals
+struct {
+	int created[STRESS_OBJECT_COUNT];
+	int destroyed[STRESS_OBJECT_COUNT];
+	int frames;
+	int contexts;
+	int contextsReleased;
+	int snapshots;
+	int noPbuffer;
+	int progress;
+	int done;
+	JNIEnv env;
+} GLOBALS;
+
+// Context current on calling thread, set only together with a surface.
+static __thread EGLContext stress_current;
+
+// Aborts run with given message.
+static void stress_Fail(const char *msg) {
+	fprintf(stderr, "gl_thread_stress: %s\n", msg);
+	abort();
+}
+
+// Counts object creation and returns unique non-zero handle for it.
+static void* stress_Create(stress_object_t object) {
+	int handle = __atomic_add_fetch(&GLOBALS.created[object], 1,
+			__ATOMIC_SEQ_CST);
+	return (void*) (intptr_t) ((handle << 3) | object);
+}
+
+// Counts object destruction and checks handle is of expected kind.
+static void stress_Destroy(stress_object_t object, void *handle) {
+	if (handle == NULL || ((intptr_t) handle & 7) != object) {
+		stress_Fail("destroying unknown EGL object");
+	}
+	__atomic_add_fetch(&GLOBALS.destroyed[object], 1, __ATOMIC_SEQ_CST);
+}
+
+// Stub ANativeWindow backend.
+ANativeWindow* ANativeWindow_fromSurface(UNUSED JNIEnv *env, jobject surface) {
+	if (surface == NULL) {
+		stress_Fail("ANativeWindow_fromSurface with null surface");
+	}
+	ANativeWindow *window = malloc(sizeof(ANativeWindow));
+	window->magic = STRESS_WINDOW_ALIVE;
+	stress_Create(STRESS_OBJECT_WINDOW);
+	return window;
+}
+
+void ANativeWindow_acquire(UNUSED ANativeWindow *window) {
+	stress_Fail("ANativeWindow_acquire is not expected");
+}
+
+void ANativeWindow_release(ANativeWindow *window) {
+	if (window == NULL || window->magic != STRESS_WINDOW_ALIVE) {
+		stress_Fail("ANativeWindow_release on released window");
+	}
+	window->magic = STRESS_WINDOW_DEAD;
+	__atomic_add_fetch(&GLOBALS.destroyed[STRESS_OBJECT_WINDOW], 1,
+			__ATOMIC_SEQ_CST);
+}
+
+int32_t ANativeWindow_setBuffersGeometry(ANativeWindow *window,
+		UNUSED int32_t width, UNUSED int32_t height, UNUSED int32_t format) {
+	if (window == NULL || window->magic != STRESS_WINDOW_ALIVE) {
+		stress_Fail("ANativeWindow_setBuffersGeometry on released window");
+	}
+	return 0;
+}
+
+// Stub EGL backend.
+EGLDisplay eglGetDisplay(UNUSED EGLNativeDisplayType displayId) {
+	return stress_Create(STRESS_OBJECT_DISPLAY);
+}
+
+EGLBoolean eglInitialize(UNUSED EGLDisplay display, EGLint *major,
+		EGLint *minor) {
+	if (major) {
+		*major = 1;
+	}
+	if (minor) {
+		*minor = 4;
+	}
+	return EGL_TRUE;
+}
+
+EGLBoolean eglTerminate(EGLDisplay display) {
+	stress_Destroy(STRESS_OBJECT_DISPLAY, display);
+	return EGL_TRUE;
+}
+
+EGLBoolean eglChooseConfig(UNUSED EGLDisplay display, const EGLint *attribs,
+		EGLConfig *configs, EGLint configSize, EGLint *numConfig) {
+	*numConfig = 1;
+	// Optionally behave like drivers without pbuffer support.
+	while (attribs && attribs[0] != EGL_NONE) {
+		if (attribs[0] == EGL_SURFACE_TYPE && (attribs[1] & EGL_PBUFFER_BIT)
+				&& GLOBALS.noPbuffer) {
+			*numConfig = 0;
+		}
+		attribs += 2;
+	}
+	if (configs && configSize > 0 && *numConfig > 0) {
+		configs[0] = (EGLConfig) 1;
+	}
+	return EGL_TRUE;
+}
+
+EGLBoolean eglGetConfigAttrib(UNUSED EGLDisplay display,
+		UNUSED EGLConfig config, UNUSED EGLint attribute, EGLint *value) {
+	*value = 8;
+	return EGL_TRUE;
+}
+
+EGLContext eglCreateContext(UNUSED EGLDisplay display, UNUSED EGLConfig config,
+		UNUSED EGLContext shareContext, UNUSED const EGLint *attribs) {
+	return stress_Create(STRESS_OBJECT_CONTEXT);
+}
+
+EGLBoolean eglDestroyContext(UNUSED EGLDisplay display, EGLContext context) {
+	stress_Destroy(STRESS_OBJECT_CONTEXT, context);
+	return EGL_TRUE;
+}
+
+EGLSurface eglCreatePbufferSurface(UNUSED EGLDisplay display,
+		UNUSED EGLConfig config, UNUSED const EGLint *attribs) {
+	// Window only configurations can't back a pbuffer.
+	if (GLOBALS.noPbuffer) {
+		return EGL_NO_SURFACE;
+	}
+	return stress_Create(STRESS_OBJECT_PBUFFER);
+}
+
+EGLSurface eglCreateWindowSurface(UNUSED EGLDisplay display,
+		UNUSED EGLConfig config, EGLNativeWindowType window,
+		UNUSED const EGLint *attribs) {
+	ANativeWindow *nativeWindow = (ANativeWindow*) window;
+	if (nativeWindow == NULL || nativeWindow->magic != STRESS_WINDOW_ALIVE) {
+		stress_Fail("eglCreateWindowSurface on released window");
+	}
+	return stress_Create(STRESS_OBJECT_WINDOW_SURFACE);
+}
+
+EGLBoolean eglDestroySurface(UNUSED EGLDisplay display, EGLSurface surface) {
+	if (((intptr_t) surface & 7) == STRESS_OBJECT_PBUFFER) {
+		stress_Destroy(STRESS_OBJECT_PBUFFER, surface);
+	} else {
+		stress_Destroy(STRESS_OBJECT_WINDOW_SURFACE, surface);
+	}
+	return EGL_TRUE;
+}
+
+EGLBoolean eglMakeCurrent(UNUSED EGLDisplay display, EGLSurface draw,
+		UNUSED EGLSurface read, EGLContext context) {
+	stress_current = draw == EGL_NO_SURFACE ? EGL_NO_CONTEXT : context;
+	return EGL_TRUE;
+}
+
+EGLBoolean eglSwapBuffers(UNUSED EGLDisplay display, EGLSurface surface) {
+	if (((intptr_t) surface & 7) != STRESS_OBJECT_WINDOW_SURFACE) {
+		stress_Fail("eglSwapBuffers without window surface");
+	}
+	struct timespec ts = { 0, STRESS_SWAP_NANOS };
+	nanosleep(&ts, NULL);
+	return EGL_TRUE;
+}
+
+EGLint eglGetError() {
+	return EGL_SUCCESS;
+}
+
+// Stub renderer callbacks (flowers_renderer.c).
+void flowers_OnRenderFrame() {
+	__atomic_add_fetch(&GLOBALS.frames, 1, __ATOMIC_SEQ_CST);
+}
+
+void flowers_OnSurfaceChanged(UNUSED int32_t width, UNUSED int32_t height) {
+}
+
+void flowers_OnContextCreated() {
+	if (stress_current == NULL) {
+		stress_Fail("onContextCreated without current context");
+	}
+	__atomic_add_fetch(&GLOBALS.contexts, 1, __ATOMIC_SEQ_CST);
+}
+
+void flowers_OnContextDestroyed() {
+	if (stress_current == NULL) {
+		stress_Fail("onContextDestroyed without current context");
+	}
+	__atomic_add_fetch(&GLOBALS.contextsReleased, 1, __ATOMIC_SEQ_CST);
+}
+
+void flowers_OnSurfaceCreated() {
+}
+
+void flowers_SceneSave(UNUSED const char *path) {
+	__atomic_add_fetch(&GLOBALS.snapshots, 1, __ATOMIC_SEQ_CST);
+}
+
+void flowers_SceneRestore(UNUSED const char *path) {
+}
+
+void flowers_LutBake(UNUSED int scheme, UNUSED uint32_t flower1,
+		UNUSED uint32_t flower2, UNUSED uint32_t bgTop,
+		UNUSED uint32_t bgBottom) {
+}
+
+// Stub JNIEnv string functions, files directory is a plain C string.
+static const char* stress_GetStringUTFChars(UNUSED JNIEnv *env, jstring str,
+		UNUSED jboolean *isCopy) {
+	return (const char*) str;
+}
+
+static void stress_ReleaseStringUTFChars(UNUSED JNIEnv *env,
+		UNUSED jstring str, UNUSED const char *chars) {
+}
+
+static const struct JNINativeInterface stress_jni = { .GetStringUTFChars =
+		stress_GetStringUTFChars, .ReleaseStringUTFChars =
+		stress_ReleaseStringUTFChars };
+
+// Fake objects passed in as jobject values.
+static char stress_filesDir[] = "/tmp";
+static char stress_surface;
+
+// Sleeps given number of milliseconds.
+static void stress_Sleep(int millis) {
+	struct timespec ts = { millis / 1000, (millis % 1000) * 1000000L };
+	nanosleep(&ts, NULL);
+}
+
+// Watchdog thread, aborts if workers stop making progress.
+static void* stress_Watchdog(UNUSED void *arg) {
+	int progress = -1;
+	int idleMillis = 0;
+	while (!__atomic_load_n(&GLOBALS.done, __ATOMIC_SEQ_CST)) {
+		stress_Sleep(100);
+		int current = __atomic_load_n(&GLOBALS.progress, __ATOMIC_SEQ_CST);
+		idleMillis = current == progress ? idleMillis + 100 : 0;
+		progress = current;
+		if (idleMillis >= STRESS_WATCHDOG_SECONDS * 1000) {
+			stress_Fail("no progress, deadlock suspected");
+		}
+	}
+	return NULL;
+}
+
+// Worker thread, calls random JNI entry points like several hosts would.
+static void* stress_Worker(void *arg) {
+	stress_worker_t *worker = arg;
+	JNIEnv *env = &GLOBALS.env;
+	unsigned int seed = worker->seed;
+	int connected = 0;
+	int iter;
+	for (iter = 0; iter < worker->iterations; ++iter) {
+		switch (rand_r(&seed) % 6) {
+		case 0:
+			flowers_Connect(env, NULL, stress_filesDir);
+			++connected;
+			break;
+		case 1:
+			if (connected > 0) {
+				flowers_Disconnect(env, NULL);
+				--connected;
+			}
+			break;
+		case 2:
+			flowers_SetPaused(env, NULL, rand_r(&seed) & 1 ? JNI_TRUE : JNI_FALSE);
+			break;
+		case 3:
+			flowers_SetSurface(env, NULL, rand_r(&seed) & 1 ? &stress_surface
+					: NULL);
+			break;
+		case 4:
+			flowers_SetSurfaceSize(env, NULL, 100 + rand_r(&seed) % 3 * 100,
+					200);
+			break;
+		case 5:
+			flowers_SetColors(env, NULL, rand_r(&seed) % 5, 0, 0, 0, 0);
+			break;
+		}
+		__atomic_add_fetch(&GLOBALS.progress, 1, __ATOMIC_SEQ_CST);
+	}
+	while (connected-- > 0) {
+		flowers_Disconnect(env, NULL);
+	}
+	return NULL;
+}
+
+// Checks every created object has been destroyed.
+static int stress_CheckObjects() {
+	int object, failed = 0;
+	for (object = 0; object < STRESS_OBJECT_COUNT; ++object) {
+		int created = __atomic_load_n(&GLOBALS.created[object],
+				__ATOMIC_SEQ_CST);
+		int destroyed = __atomic_load_n(&GLOBALS.destroyed[object],
+				__ATOMIC_SEQ_CST);
+		printf("  %-14s created=%d destroyed=%d\n", stress_objectNames[object],
+				created, destroyed);
+		if (created != destroyed) {
+			failed = 1;
+		}
+	}
+	return failed;
+}
+
+// Single host going through regular lifecycle, has to render frames.
+static int stress_RunSequential() {
+	JNIEnv *env = &GLOBALS.env;
+	int millis;
+	flowers_Connect(env, NULL, stress_filesDir);
+	flowers_SetSurface(env, NULL, &stress_surface);
+	flowers_SetSurfaceSize(env, NULL, 100, 200);
+	flowers_SetPaused(env, NULL, JNI_FALSE);
+	for (millis = 0; millis < STRESS_WATCHDOG_SECONDS * 1000; millis += 10) {
+		if (__atomic_load_n(&GLOBALS.frames, __ATOMIC_SEQ_CST) > 0) {
+			break;
+		}
+		stress_Sleep(10);
+	}
+	flowers_SetPaused(env, NULL, JNI_TRUE);
+	flowers_SetSurface(env, NULL, NULL);
+	flowers_Disconnect(env, NULL);
+	return __atomic_load_n(&GLOBALS.frames, __ATOMIC_SEQ_CST) > 0 ? 0 : 1;
+}
+
+// Several hosts calling entry points concurrently.
+static void stress_RunConcurrent(int threadCount, int iterations) {
+	pthread_t threads[threadCount];
+	stress_worker_t workers[threadCount];
+	pthread_t watchdog;
+	int idx;
+	__atomic_store_n(&GLOBALS.done, 0, __ATOMIC_SEQ_CST);
+	pthread_create(&watchdog, NULL, stress_Watchdog, NULL);
+	for (idx = 0; idx < threadCount; ++idx) {
+		workers[idx].seed = idx + 1;
+		workers[idx].iterations = iterations;
+		pthread_create(&threads[idx], NULL, stress_Worker, &workers[idx]);
+	}
+	for (idx = 0; idx < threadCount; ++idx) {
+		pthread_join(threads[idx], NULL);
+	}
+	__atomic_store_n(&GLOBALS.done, 1, __ATOMIC_SEQ_CST);
+	pthread_join(watchdog, NULL);
+}
+
+// Prints collected entry point latency histograms.
+static void stress_PrintLatencies() {
+	int entry, bucket;
+	printf("first frame %dms, eager start %d\n", flowers_firstFrameMillis,
+			FLOWERS_EAGER_START);
+	printf("latencies:\n");
+	for (entry = 0; entry < FLOWERS_ENTRY_COUNT; ++entry) {
+		flowers_latency_t *latency = &flowers_latency[entry];
+		printf("  %-14s count=%u max=%lldus\n", flowers_entryNames[entry],
+				latency->count, (long long) (latency->maxNanos / 1000));
+		for (bucket = 0; bucket < FLOWERS_LATENCY_BUCKETS; ++bucket) {
+			if (latency->buckets[bucket]) {
+				printf("    %s%dus: %u\n",
+						bucket == FLOWERS_LATENCY_BUCKETS - 1 ? ">=" : "<",
+						bucket == FLOWERS_LATENCY_BUCKETS - 1 ? 1 << bucket
+								: 2 << bucket, latency->buckets[bucket]);
+			}
+		}
+	}
+}
+
+int main(int argc, char **argv) {
+	int threadCount = STRESS_THREADS;
+	int iterations = STRESS_ITERATIONS;
+	int failed = 0;
+	if (argc == 3) {
+		threadCount = atoi(argv[1]);
+		iterations = atoi(argv[2]);
+	}
+	if (threadCount < 1 || iterations < 1) {
+		fprintf(stderr, "usage: %s [threads iterations]\n", argv[0]);
+		return 1;
+	}
+	GLOBALS.env = &stress_jni;
+
+	if (stress_RunSequential()) {
+		printf("sequential: no frames rendered\n");
+		failed = 1;
+	}
+	stress_RunConcurrent(threadCount, iterations);
+	printf("concurrent: frames=%d contexts=%d snapshots=%d\n", GLOBALS.frames,
+			GLOBALS.contexts, GLOBALS.snapshots);
+	// With pbuffers every initialized context gets released by renderer.
+	if (GLOBALS.contexts != GLOBALS.contextsReleased) {
+		printf("contexts created=%d released=%d\n", GLOBALS.contexts,
+				GLOBALS.contextsReleased);
+		failed = 1;
+	}
+	// Same again for drivers with window only configs.
+	GLOBALS.noPbuffer = 1;
+	stress_RunConcurrent(threadCount, iterations);
+	printf("concurrent without pbuffers: frames=%d contexts=%d\n",
+			GLOBALS.frames, GLOBALS.contexts);
+
+	if (flowers_hostCount != 0) {
+		printf("host count %d after all hosts disconnected\n",
+				flowers_hostCount);
+		failed = 1;
+	}
+	printf("objects:\n");
+	failed |= stress_CheckObjects();
+	stress_PrintLatencies();
+	printf(failed ? "FAILED\n" : "OK\n");
+	return failed;
+}
@@ -0,0 +1,34 @@
+/*
+ Copyright 2012 Harri Smtt
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+ */
+
+/*
+ Minimal host replacement for NDK android/native_window.h used by
+ tools/gl_thread_stress.c. Harness provides the implementation.
+ */
+
+#ifndef STUB_ANDROID_NATIVE_WINDOW_H__
+#define STUB_ANDROID_NATIVE_WINDOW_H__
+
+#include <stdint.h>
+
+typedef struct ANativeWindow ANativeWindow;
+
+void ANativeWindow_acquire(ANativeWindow *window);
+void ANativeWindow_release(ANativeWindow *window);
+int32_t ANativeWindow_setBuffersGeometry(ANativeWindow *window, int32_t width,
+		int32_t height, int32_t format);
+
+#endif
@@ -0,0 +1,30 @@
+/*
+ Copyright 2012 Harri Smtt
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+ */
+
+/*
+ Minimal host replacement for NDK android/native_window_jni.h used by
+ tools/gl_thread_stress.c. Harness provides the implementation.
+ */
+
+#ifndef STUB_ANDROID_NATIVE_WINDOW_JNI_H__
+#define STUB_ANDROID_NATIVE_WINDOW_JNI_H__
+
+#include <android/native_window.h>
+#include <jni.h>
+
+ANativeWindow* ANativeWindow_fromSurface(JNIEnv *env, jobject surface);
+
+#endif
@@ -0,0 +1,67 @@
+/*
+ Copyright 2012 Harri Smtt
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+ */
+
+/*
+ Minimal host replacement for NDK jni.h used by tools/gl_thread_stress.c.
+ Declares only what flowers_main.c touches, function table members are
+ filled in by the harness.
+ */
+
+#ifndef STUB_JNI_H__
+#define STUB_JNI_H__
+
+#include <stdint.h>
+
+typedef uint8_t jboolean;
+typedef int32_t jint;
+typedef void* jobject;
+typedef jobject jclass;
+typedef jobject jstring;
+
+#define JNI_FALSE        0
+#define JNI_TRUE         1
+#define JNI_OK           0
+#define JNI_ERR          (-1)
+#define JNI_VERSION_1_4  0x00010004
+
+#define JNIEXPORT __attribute__ ((visibility ("default")))
+#define JNICALL
+
+typedef struct {
+	const char *name;
+	const char *signature;
+	void *fnPtr;
+} JNINativeMethod;
+
+struct JNINativeInterface;
+typedef const struct JNINativeInterface* JNIEnv;
+
+struct JNINativeInterface {
+	jclass (*FindClass)(JNIEnv*, const char*);
+	jint (*RegisterNatives)(JNIEnv*, jclass, const JNINativeMethod*, jint);
+	void (*DeleteLocalRef)(JNIEnv*, jobject);
+	const char* (*GetStringUTFChars)(JNIEnv*, jstring, jboolean*);
+	void (*ReleaseStringUTFChars)(JNIEnv*, jstring, const char*);
+};
+
+struct JNIInvokeInterface;
+typedef const struct JNIInvokeInterface* JavaVM;
+
+struct JNIInvokeInterface {
+	jint (*GetEnv)(JavaVM*, void**, jint);
+};
+
+#endif